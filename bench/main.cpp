@@ -0,0 +1,262 @@
+// MyLogger 性能测试。结果以 JSON 格式输出到标准输出(以及可选的文件)，便于在修改 ThreadsPool、Formatter、
+// LogWriter 后比较性能变化。
+// 用法: bench [结果文件] [每项测试的日志条数] [后台线程等待策略: blocking|spin|busy|timed]
+
+#include "MyLogger/logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using log = Logger;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char* const kFileSinkPath = "bench.log";
+const char* const kNullSinkPath = "/dev/null";
+
+enum class Sink { FILE, CONSOLE, NULL_SINK };
+
+const char* sinkName(Sink sink) {
+    switch (sink) {
+    case Sink::FILE:
+        return "file";
+    case Sink::CONSOLE:
+        return "console";
+    case Sink::NULL_SINK:
+        return "null";
+    }
+    return "";
+}
+
+// 在作用域内将标准输出重定向到 /dev/null, 避免控制台输出干扰测试结果
+class StdoutSilencer {
+  private:
+    int m_saved_fd;
+
+  public:
+    StdoutSilencer() {
+        std::cout.flush();
+        m_saved_fd = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    ~StdoutSilencer() {
+        std::cout.flush();
+        dup2(m_saved_fd, STDOUT_FILENO);
+        close(m_saved_fd);
+    }
+};
+
+// 将日志只输出到指定的目标
+void useSink(Sink sink) {
+    log::enableConsole(sink == Sink::CONSOLE);
+    log::enabledFile(sink != Sink::CONSOLE);
+    log::setFile(sink == Sink::FILE ? kFileSinkPath : kNullSinkPath);
+}
+
+double nanosecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double p) {
+    std::size_t index = static_cast<std::size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+// 测量调用线程上单次日志调用(入队)的耗时
+template <typename Func>
+std::string measureLatency(std::size_t count, Func&& func) {
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        auto start = Clock::now();
+        func(i);
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    log::flush();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::ostringstream oss;
+    oss << "{\"p50_ns\": " << percentile(latencies, 0.5) << ", \"p99_ns\": " << percentile(latencies, 0.99)
+        << ", \"p999_ns\": " << percentile(latencies, 0.999) << ", \"max_ns\": " << latencies.back() << "}";
+    return oss.str();
+}
+
+// 测量 threads 个线程各写入 count 条日志，直到全部输出完毕的耗时，返回每秒日志条数
+template <typename Func>
+double measureThroughput(unsigned int threads, std::size_t count, Func&& func) {
+    auto start = Clock::now();
+
+    std::vector<std::thread> producers;
+    for (unsigned int t = 0; t < threads; t++) {
+        producers.emplace_back([&] {
+            for (std::size_t i = 0; i < count; i++) {
+                func(i);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    log::flush();
+
+    return threads * count / (nanosecondsSince(start) / 1e9);
+}
+
+} // namespace
+
+// 直接调用 Formatter 测量各类占位符的格式化开销: 每条日志重置 Formatter、解析格式化字符串并生成日志文本,
+// 与格式化线程的工作相同，但不经过队列与输出线程。Formatter 的成员均为私有，由 Formatter 将本类声明为友元。
+class FormatterBench {
+  private:
+    struct Case {
+        const char* name;
+        void (*func)(Formatter&, std::size_t);
+    };
+
+  public:
+    // 以 JSON 对象的成员输出每个用例单条日志的耗时(纳秒)
+    static void run(std::ostream& json, std::size_t count) {
+        const Case cases[] = {
+            {"text",
+             [](Formatter& f, std::size_t) { f.parseFormatString("plain text message without placeholders\n"); }},
+            {"int", [](Formatter& f, std::size_t i) { f.parseFormatString("value {}\n", static_cast<int>(i)); }},
+            {"double", [](Formatter& f, std::size_t i) { f.parseFormatString("value {}\n", i * 0.5); }},
+            {"string",
+             [](Formatter& f, std::size_t) { f.parseFormatString("value {}\n", std::string("a short string")); }},
+            {"c_string", [](Formatter& f, std::size_t) { f.parseFormatString("value {}\n", "a short string"); }},
+            {"positional", [](Formatter& f, std::size_t i) { f.parseFormatString("value {1} {0}\n", i, i + 1); }},
+            {"level", [](Formatter& f, std::size_t) { f.parseFormatString("{level} message\n"); }},
+            {"time", [](Formatter& f, std::size_t) { f.parseFormatString("{time} message\n"); }},
+            {"time_custom", [](Formatter& f, std::size_t) { f.parseFormatString("{time:%H:%M:%S} message\n"); }},
+            {"thread", [](Formatter& f, std::size_t) { f.parseFormatString("{thread} message\n"); }},
+            {"thread_hex", [](Formatter& f, std::size_t) { f.parseFormatString("{thread:x} message\n"); }},
+        };
+
+        Formatter formatter(LogLevel::INFO);
+        std::size_t total_size = 0; // 使用格式化结果，避免被编译器优化掉
+        bool first = true;
+        for (const Case& format_case : cases) {
+            auto start = Clock::now();
+            for (std::size_t i = 0; i < count; i++) {
+                formatter.reset(LogLevel::INFO);
+                format_case.func(formatter, i);
+                total_size += formatter.formatedString().size();
+            }
+            double ns = nanosecondsSince(start) / static_cast<double>(count);
+            json << (first ? "" : ",") << "\n    \"" << format_case.name << "\": " << static_cast<std::uint64_t>(ns);
+            first = false;
+        }
+        if (total_size == 0)
+            std::cerr << "Formatter produced no output\n";
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::string output_file = argc > 1 ? argv[1] : "";
+    std::size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    std::string wait_strategy = argc > 3 ? argv[3] : "blocking";
+
+    BackendOptions options;
+    if (wait_strategy == "spin") {
+        options.wait_strategy = WaitStrategy::SPIN_THEN_PARK;
+    } else if (wait_strategy == "busy") {
+        options.wait_strategy = WaitStrategy::BUSY_POLL;
+    } else if (wait_strategy == "timed") {
+        options.wait_strategy = WaitStrategy::TIMED;
+    } else {
+        wait_strategy = "blocking";
+    }
+    log::setBackendOptions(options);
+    log::setLevel(LogLevel::DEBUG);
+
+    std::ostringstream json;
+    json << "{\n  \"messages\": " << count << ",\n";
+    json << "  \"wait_strategy\": \"" << wait_strategy << "\",\n";
+
+    // 1. 调用线程的入队延迟
+    useSink(Sink::NULL_SINK);
+    std::string name = "Alice";
+    json << "  \"enqueue_latency\": {\n";
+    json << "    \"args_0\": " << measureLatency(count, [](std::size_t) { log::info("latency benchmark message\n"); })
+         << ",\n";
+    json << "    \"args_2\": "
+         << measureLatency(count, [&](std::size_t i) { log::info("latency {} {}\n", i, name); }) << ",\n";
+    json << "    \"args_8\": " << measureLatency(count, [&](std::size_t i) {
+        log::info("latency {} {} {} {} {} {} {} {}\n", i, name, 3.14, 'c', "text", -1L, true, 42u);
+    }) << ",\n";
+
+    // 轮流调用各等级、各输出目标的日志函数，热路径的指令缓存占用随这些函数各自实例化的份数增长
+    using MixedCall = void (*)(std::size_t, const std::string&);
+    const MixedCall mixed_calls[] = {
+        [](std::size_t i, const std::string& s) { log::debug("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::info("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::warning("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::error("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::debugf("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::infof("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::warningf("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::errorf("mixed {} {}\n", i, s); },
+        [](std::size_t i, const std::string& s) { log::log(static_cast<LogLevel>(i % 4), "mixed {} {}\n", i, s); },
+    };
+    const std::size_t mixed_count = sizeof(mixed_calls) / sizeof(mixed_calls[0]);
+    json << "    \"mixed_levels\": "
+         << measureLatency(count, [&](std::size_t i) { mixed_calls[i % mixed_count](i, name); }) << "\n  },\n";
+
+    // 2. 多个生产者线程下的持续吞吐量
+    unsigned int max_threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    json << "  \"throughput_msgs_per_sec\": {";
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        double rate = measureThroughput(threads, count / threads, [&](std::size_t i) {
+            log::info("{time} [{level}] throughput {} {}\n", i, name);
+        });
+        json << (threads == 1 ? "" : ",") << "\n    \"threads_" << threads << "\": " << static_cast<std::uint64_t>(rate);
+    }
+    json << "\n  },\n";
+
+    // 3. 各类占位符的格式化开销(直接调用 Formatter, 单条日志的耗时)
+    json << "  \"format_ns_per_msg\": {";
+    FormatterBench::run(json, count);
+    json << "\n  },\n";
+
+    // 4. 各输出目标的端到端吞吐量
+    json << "  \"sink_msgs_per_sec\": {";
+    bool first = true;
+    for (Sink sink : {Sink::FILE, Sink::CONSOLE, Sink::NULL_SINK}) {
+        useSink(sink);
+        double rate;
+        {
+            StdoutSilencer silencer;
+            rate = measureThroughput(1, count, [&](std::size_t i) {
+                log::info("{time} [{level}] end to end {} {}\n", i, name);
+            });
+        }
+        json << (first ? "" : ",") << "\n    \"" << sinkName(sink) << "\": " << static_cast<std::uint64_t>(rate);
+        first = false;
+    }
+    json << "\n  }\n}\n";
+    std::remove(kFileSinkPath);
+
+    std::cout << json.str();
+    if (!output_file.empty()) {
+        std::ofstream file(output_file);
+        file << json.str();
+    }
+
+    return 0;
+}
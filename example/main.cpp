@@ -45,6 +45,13 @@ int main() {
     log::info("I am {0}. I am {0}.\n", name);
     // 优先匹配指定位置参数的占位符, 再按顺序匹配空占位符. 剩余参数会直接拼接在后面. 若参数数量不够, 则会报错.
     log::info("My name is {1}, and I am {} years old.", name, age, " Nice to meet you.\n");
+    // 占位符支持 std::format 的格式说明: 进制、精度、宽度与对齐, 也可以与位置参数一起使用.
+    log::info("{:#x} {:.3f} [{:>8}]\n", 255, 3.14159, name); // 输出 "0xff 3.142 [   Alice]"
+    log::info("[{0:08.2f}] [{0:e}]\n", 3.14159);             // 输出 "[00003.14] [3.141590e+00]"
+    // 参数可以是 lambda, 只有日志通过日志等级等检查后才会调用, 被过滤掉的日志不产生开销.
+    log::debug("name length: {}\n", [&] { return name.size(); });
+    // log::deferred() 将调用推迟到后台的格式化线程, lambda 需要按值捕获.
+    log::debug("name: {}\n", log::deferred([name] { return name + "!"; }));
 
     return 0;
 }
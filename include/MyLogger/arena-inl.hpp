@@ -0,0 +1,183 @@
+// arena 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_ARENA_INL_HPP
+#define MYLOGGER_ARENA_INL_HPP
+
+#ifndef MYLOGGER_ARENA_HPP
+#include "arena.hpp"
+#endif // MYLOGGER_ARENA_HPP
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+MYLOGGER_INLINE LogArena::LogArena()
+    : m_region(nullptr), m_chunk_count(0), m_head(kNil), m_free_chunks(0), m_fallbacks(0) {}
+
+MYLOGGER_INLINE LogArena& LogArena::getArena() {
+    // 线程退出时交出的块可能晚于线程池析构，内存区一直保留到进程退出，与共享缓冲区相同
+    static LogArena instance;
+    return instance;
+}
+
+MYLOGGER_INLINE LogArena::Cache::~Cache() {
+    retire(*this);
+}
+
+MYLOGGER_INLINE LogArena::Cache& LogArena::cache() {
+    static thread_local Cache instance;
+    return instance;
+}
+
+MYLOGGER_INLINE void LogArena::configure(const ArenaOptions& options) {
+    if (options.budget == 0 || m_region)
+        return;
+
+#ifdef __linux__
+    std::size_t size = (options.budget + kChunkSize - 1) / kChunkSize * kChunkSize;
+    char* region = nullptr;
+
+    if (options.huge_pages == HugePages::EXPLICIT) {
+        std::size_t huge_size = (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        void* p = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            region = static_cast<char*>(p);
+            size = huge_size;
+        }
+    }
+
+    if (!region) {
+        // 多映射一个大页的长度，将起始地址对齐到大页边界，透明大页才能覆盖整个内存区
+        std::size_t mapped = size + kHugePageSize;
+        void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return;
+        std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(p);
+        std::uintptr_t aligned = (begin + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        if (aligned > begin)
+            munmap(p, aligned - begin);
+        munmap(reinterpret_cast<void*>(aligned + size), begin + mapped - aligned - size);
+        region = reinterpret_cast<char*>(aligned);
+        if (options.huge_pages != HugePages::NONE)
+            madvise(region, size, MADV_HUGEPAGE);
+    }
+
+    // 逐页写入，在启动时完成缺页处理
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (std::size_t offset = 0; offset < size; offset += static_cast<std::size_t>(page_size > 0 ? page_size : 4096))
+        region[offset] = 0;
+
+    m_chunk_count = size / kChunkSize;
+    for (std::size_t i = 0; i < m_chunk_count; i++) {
+        Chunk* chunk = new (region + i * kChunkSize) Chunk();
+        chunk->next.store(i + 1 < m_chunk_count ? static_cast<std::uint32_t>(i + 1) : kNil, std::memory_order_relaxed);
+    }
+    m_region = region;
+    m_free_chunks.store(m_chunk_count, std::memory_order_relaxed);
+    m_head.store(0, std::memory_order_release);
+#else
+    (void)options;
+#endif
+}
+
+MYLOGGER_INLINE LogArena::Chunk* LogArena::chunkAt(std::uint32_t index) const {
+    return reinterpret_cast<Chunk*>(m_region + static_cast<std::size_t>(index) * kChunkSize);
+}
+
+MYLOGGER_INLINE LogArena::Chunk* LogArena::acquireChunk() {
+    std::uint64_t head = m_head.load(std::memory_order_acquire);
+    while (true) {
+        std::uint32_t index = static_cast<std::uint32_t>(head & kIndexMask);
+        if (index == kNil)
+            return nullptr;
+
+        Chunk* chunk = chunkAt(index);
+        std::uint32_t next = chunk->next.load(std::memory_order_relaxed);
+        std::uint64_t new_head = (((head >> 32) + 1) << 32) | next;
+        if (m_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
+            m_free_chunks.fetch_sub(1, std::memory_order_relaxed);
+            chunk->live.store(kBias, std::memory_order_relaxed);
+            return chunk;
+        }
+    }
+}
+
+MYLOGGER_INLINE void LogArena::releaseChunk(Chunk* chunk) {
+    std::uint32_t index = static_cast<std::uint32_t>((reinterpret_cast<char*>(chunk) - m_region) / kChunkSize);
+    m_free_chunks.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t head = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        chunk->next.store(static_cast<std::uint32_t>(head & kIndexMask), std::memory_order_relaxed);
+        std::uint64_t new_head = (((head >> 32) + 1) << 32) | index;
+        if (m_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
+}
+
+MYLOGGER_INLINE void LogArena::retire(Cache& cache) {
+    Chunk* chunk = cache.chunk;
+    if (!chunk)
+        return;
+    cache.chunk = nullptr;
+
+    std::uint64_t remaining = kBias - cache.count;
+    if (chunk->live.fetch_sub(remaining, std::memory_order_acq_rel) == remaining)
+        getArena().releaseChunk(chunk);
+}
+
+MYLOGGER_INLINE void* LogArena::allocate(std::size_t size) {
+    LogArena& arena = getArena();
+    std::size_t total = sizeof(AllocationHeader) + (size + kAlign - 1) / kAlign * kAlign;
+
+    AllocationHeader* header = nullptr;
+    if (arena.m_region && total <= kChunkSize - sizeof(Chunk)) {
+        Cache& c = cache();
+        if (!c.chunk || c.used + total > kChunkSize) {
+            retire(c);
+            c.chunk = arena.acquireChunk();
+            c.used = sizeof(Chunk);
+            c.count = 0;
+        }
+        if (c.chunk) {
+            header = reinterpret_cast<AllocationHeader*>(reinterpret_cast<char*>(c.chunk) + c.used);
+            header->chunk = c.chunk;
+            c.used += total;
+            c.count++;
+        }
+    }
+
+    if (!header) {
+        // 未启用、预算耗尽或超过一个块: 退化为 new
+        if (arena.m_region)
+            arena.m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+        header = static_cast<AllocationHeader*>(::operator new(total));
+        header->chunk = nullptr;
+    }
+    return header + 1;
+}
+
+MYLOGGER_INLINE void LogArena::deallocate(void* p) noexcept {
+    if (!p)
+        return;
+    AllocationHeader* header = static_cast<AllocationHeader*>(p) - 1;
+    Chunk* chunk = header->chunk;
+    if (!chunk) {
+        ::operator delete(header);
+        return;
+    }
+    if (chunk->live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        getArena().releaseChunk(chunk);
+}
+
+MYLOGGER_INLINE std::size_t LogArena::usedBytes() const {
+    return (m_chunk_count - m_free_chunks.load(std::memory_order_relaxed)) * kChunkSize;
+}
+
+MYLOGGER_INLINE unsigned long long LogArena::fallbacks() const {
+    return m_fallbacks.load(std::memory_order_relaxed);
+}
+
+#endif // MYLOGGER_ARENA_INL_HPP
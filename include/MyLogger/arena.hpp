@@ -0,0 +1,211 @@
+// 后台任务使用的内存区(Arena): 队列中的任务对象与队列自身的节点都从一块预先分配的内存中分配，
+// 稳定运行时不再为每条日志调用 malloc/free. 通过 BackendOptions::arena 设置预算，默认不启用(仍使用 new/delete)。
+//
+// 内存区按 kChunkSize 划分为块，空闲块通过无锁链表管理(与 FormatterPool 相同)。每个线程持有一个当前块，
+// 在其中顺序(bump)分配; 块写满后由所属线程交出，块内的所有分配都被释放后(可以在任意线程中释放)回到空闲链表。
+// 日志按先进先出的顺序处理，因此块基本按分配的顺序回收。预算耗尽或单次分配超过一个块时退化为 new,
+// 次数记录在 LoggerStats::arena_fallbacks 中。
+//
+// 内存区可以使用大页以减少 TLB 缺失: EXPLICIT 使用 MAP_HUGETLB(需要预留 hugetlbfs 大页，失败时退化为普通页),
+// TRANSPARENT 对普通映射调用 madvise(MADV_HUGEPAGE). 映射后立即逐页写入，避免稳定运行时产生缺页。仅 Linux 支持。
+
+#pragma once
+
+#ifndef MYLOGGER_ARENA_HPP
+#define MYLOGGER_ARENA_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+
+// 内存区使用的页
+enum class HugePages {
+    NONE,        // 普通页
+    TRANSPARENT, // 透明大页(madvise)
+    EXPLICIT,    // hugetlbfs 大页(MAP_HUGETLB)，失败时退化为 TRANSPARENT
+};
+
+// 内存区的参数，作为 BackendOptions::arena 设置
+struct ArenaOptions {
+    std::size_t budget = 0;                     // 内存区的总大小(字节)，0 表示不启用
+    HugePages huge_pages = HugePages::TRANSPARENT;
+};
+
+class LogArena {
+  private:
+    // 友元类声明，仅允许 Logger 类与 ThreadsPool 类访问私有成员
+    friend class Logger;
+    friend class ThreadsPool;
+    friend class LogTask;
+    template <typename T>
+    friend class LogArenaAllocator;
+
+  public:
+    static constexpr std::size_t kChunkSize = 64 * 1024;
+    static constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+    static constexpr std::size_t kAlign = 16; // 分配结果的对齐
+
+  private:
+    static constexpr std::uint32_t kNil = 0xFFFFFFFF;
+    static constexpr std::uint64_t kIndexMask = 0xFFFFFFFF;
+
+    // 块未交出时 live 的初始值。每次释放减 1，所属线程交出块时减去 kBias - 块内的分配次数，减到 0 的一方回收块。
+    static constexpr std::uint64_t kBias = std::uint64_t(1) << 62;
+
+    // 位于每个块的开头
+    struct alignas(64) Chunk {
+        std::atomic<std::uint64_t> live;
+        std::atomic<std::uint32_t> next; // 空闲链表中下一个块的下标
+    };
+
+    // 每次分配之前的头部，记录所属的块; 退化为 new 的分配为 nullptr
+    struct alignas(kAlign) AllocationHeader {
+        Chunk* chunk;
+    };
+
+    // 线程当前用于分配的块，线程退出时交出
+    struct Cache {
+        Chunk* chunk = nullptr;
+        std::size_t used = 0;     // 块内已使用的字节数
+        std::uint64_t count = 0;  // 块内的分配次数
+        ~Cache();
+    };
+
+  private:
+    char* m_region;
+    std::size_t m_chunk_count;
+    std::atomic<std::uint64_t> m_head; // 空闲链表头: 高 32 位为版本号，低 32 位为块的下标
+    std::atomic<std::size_t> m_free_chunks;
+    std::atomic<unsigned long long> m_fallbacks;
+
+  private:
+    LogArena();
+    ~LogArena() = default;
+    LogArena(const LogArena&) = delete;
+    LogArena& operator=(const LogArena&) = delete;
+
+    static LogArena& getArena();
+    static Cache& cache();
+
+    // 映射内存区。由线程池在启动后台线程之前调用一次，失败时保持不启用。
+    void configure(const ArenaOptions& options);
+
+    // 分配 size 字节，按 kAlign 对齐
+    static void* allocate(std::size_t size);
+
+    // 释放 allocate() 分配的内存，可以在任意线程调用
+    static void deallocate(void* p) noexcept;
+
+    Chunk* chunkAt(std::uint32_t index) const;
+    Chunk* acquireChunk();
+    void releaseChunk(Chunk* chunk);
+
+    // 交出线程当前的块
+    static void retire(Cache& cache);
+
+    // 正在使用的内存区字节数与退化为 new 的分配次数
+    std::size_t usedBytes() const;
+    unsigned long long fallbacks() const;
+};
+
+// 从 LogArena 分配内存的分配器，用于线程池的任务队列
+template <typename T>
+class LogArenaAllocator {
+  public:
+    using value_type = T;
+
+    LogArenaAllocator() noexcept = default;
+    template <typename U>
+    LogArenaAllocator(const LogArenaAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        static_assert(alignof(T) <= LogArena::kAlign, "LogArenaAllocator does not support over-aligned types.");
+        return static_cast<T*>(LogArena::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        LogArena::deallocate(p);
+    }
+
+    template <typename U>
+    bool operator==(const LogArenaAllocator<U>&) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const LogArenaAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+// 线程池的任务，代替 std::function<void(void)>: 可调用对象存放在 LogArena 中，只能移动
+class LogTask {
+  private:
+    void* m_callable;
+    void (*m_invoke)(void*);
+    void (*m_destroy)(void*);
+
+  public:
+    LogTask() noexcept : m_callable(nullptr), m_invoke(nullptr), m_destroy(nullptr) {}
+
+    template <typename Func, typename = std::enable_if_t<!std::is_same<std::decay_t<Func>, LogTask>::value>>
+    LogTask(Func&& func);
+
+    LogTask(LogTask&& other) noexcept
+        : m_callable(std::exchange(other.m_callable, nullptr)), m_invoke(other.m_invoke), m_destroy(other.m_destroy) {}
+
+    LogTask& operator=(LogTask&& other) noexcept {
+        if (this != &other) {
+            if (m_callable)
+                m_destroy(m_callable);
+            m_callable = std::exchange(other.m_callable, nullptr);
+            m_invoke = other.m_invoke;
+            m_destroy = other.m_destroy;
+        }
+        return *this;
+    }
+
+    LogTask(const LogTask&) = delete;
+    LogTask& operator=(const LogTask&) = delete;
+
+    ~LogTask() {
+        if (m_callable)
+            m_destroy(m_callable);
+    }
+
+    void operator()() {
+        m_invoke(m_callable);
+    }
+};
+
+template <typename Func, typename>
+LogTask::LogTask(Func&& func) {
+    using Callable = std::decay_t<Func>;
+    static_assert(alignof(Callable) <= LogArena::kAlign, "LogTask does not support over-aligned callables.");
+
+    void* storage = LogArena::allocate(sizeof(Callable));
+    try {
+        m_callable = new (storage) Callable(std::forward<Func>(func));
+    } catch (...) {
+        LogArena::deallocate(storage);
+        throw;
+    }
+    m_invoke = [](void* callable) { (*static_cast<Callable*>(callable))(); };
+    m_destroy = [](void* callable) {
+        static_cast<Callable*>(callable)->~Callable();
+        LogArena::deallocate(callable);
+    };
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_ARENA_INL_HPP
+#include "arena-inl.hpp"
+MYLOGGER_ARENA_INL_HPP
+#endif // MYLOGGER_ARENA_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_ARENA_HPP
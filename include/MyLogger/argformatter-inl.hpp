@@ -0,0 +1,173 @@
+// argformatter 相关类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_ARGFORMATTER_INL_HPP
+#define MYLOGGER_ARGFORMATTER_INL_HPP
+
+#ifndef MYLOGGER_ARGFORMATTER_HPP
+#include "argformatter.hpp"
+#endif // MYLOGGER_ARGFORMATTER_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+MYLOGGER_INLINE FormatSpec FormatSpec::parse(const std::string& text) {
+    FormatSpec spec;
+    std::size_t i = 0;
+
+    auto isAlign = [](char c) { return c == '<' || c == '>' || c == '^'; };
+    auto parseNumber = [&]() {
+        int value = 0;
+        while (i < text.size() && std::isdigit(static_cast<unsigned char>(text[i]))) {
+            value = value * 10 + (text[i++] - '0');
+            if (value > 65536) {
+                throw std::runtime_error("Invalid format spec: width or precision is too large: " + text + ".");
+            }
+        }
+        return value;
+    };
+
+    // [[fill]align]
+    if (text.size() >= 2 && isAlign(text[1])) {
+        spec.fill = text[0];
+        spec.align = text[1];
+        i = 2;
+    } else if (!text.empty() && isAlign(text[0])) {
+        spec.align = text[0];
+        i = 1;
+    }
+
+    // [sign][#][0]
+    if (i < text.size() && (text[i] == '+' || text[i] == '-' || text[i] == ' ')) {
+        spec.sign = text[i++];
+    }
+    if (i < text.size() && text[i] == '#') {
+        spec.alternate = true;
+        i++;
+    }
+    if (i < text.size() && text[i] == '0') {
+        spec.zero_pad = true;
+        i++;
+    }
+
+    // [width][.precision]
+    spec.width = parseNumber();
+    if (i < text.size() && text[i] == '.') {
+        i++;
+        if (i == text.size() || !std::isdigit(static_cast<unsigned char>(text[i]))) {
+            throw std::runtime_error("Invalid format spec: missing precision: " + text + ".");
+        }
+        spec.precision = parseNumber();
+    }
+
+    // [type]
+    if (i < text.size()) {
+        spec.type = text[i++];
+        if (!std::strchr("dxXobBcfFeEgGsp", spec.type)) {
+            throw std::runtime_error("Invalid format spec: unknown type '" + std::string(1, spec.type) + "': " + text +
+                                     ".");
+        }
+    }
+    if (i != text.size()) {
+        throw std::runtime_error("Invalid format spec: " + text + ".");
+    }
+
+    return spec;
+}
+
+MYLOGGER_INLINE void FormatSpec::check(const char* types, bool allow_precision, const char* kind) const {
+    // '\0' 也会被 strchr 找到(字符串结尾)，因此单独判断
+    if (type != '\0' && !std::strchr(types, type)) {
+        throw std::runtime_error("Invalid format spec: type '" + std::string(1, type) + "' is not supported for " +
+                                 kind + " argument.");
+    }
+    if (precision >= 0 && !allow_precision) {
+        throw std::runtime_error(std::string("Invalid format spec: precision is not allowed for ") + kind +
+                                 " argument.");
+    }
+}
+
+MYLOGGER_INLINE void FormatSpec::pad(std::string& out, const char* text, std::size_t size, char default_align) const {
+    std::size_t fill_count = static_cast<std::size_t>(width) > size ? width - size : 0;
+    char how = align ? align : default_align;
+    std::size_t left = how == '>' ? fill_count : how == '^' ? fill_count / 2 : 0;
+
+    out.append(left, fill);
+    out.append(text, size);
+    out.append(fill_count - left, fill);
+}
+
+MYLOGGER_INLINE void FormatSpec::padNumber(std::string& out, char sign, const char* prefix, const char* digits,
+                                           std::size_t size) const {
+    std::size_t prefix_size = std::strlen(prefix);
+    std::size_t total = (sign ? 1 : 0) + prefix_size + size;
+    std::size_t fill_count = static_cast<std::size_t>(width) > total ? width - total : 0;
+
+    // 指定对齐方式时忽略 '0' 标志，与 std::format 一致
+    bool zeros = zero_pad && !align;
+    char how = align ? align : '>';
+    std::size_t left = zeros ? 0 : how == '>' ? fill_count : how == '^' ? fill_count / 2 : 0;
+
+    out.append(left, fill);
+    if (sign)
+        out += sign;
+    out.append(prefix, prefix_size);
+    if (zeros)
+        out.append(fill_count, '0');
+    out.append(digits, size);
+    if (!zeros)
+        out.append(fill_count - left, fill);
+}
+
+MYLOGGER_INLINE void ArgFormatter<std::string_view>::format(std::string& out, std::string_view value,
+                                                             const FormatSpec& spec) {
+    spec.check("s", true, "a string");
+    std::size_t size = value.size();
+    if (spec.precision >= 0 && static_cast<std::size_t>(spec.precision) < size)
+        size = spec.precision;
+
+    if (spec.width == 0) {
+        out.append(value.data(), size); // 无需填充，直接拷贝
+    } else {
+        spec.pad(out, value.data(), size);
+    }
+}
+
+MYLOGGER_INLINE void ArgFormatter<std::string>::format(std::string& out, const std::string& value,
+                                                        const FormatSpec& spec) {
+    ArgFormatter<std::string_view>::format(out, value, spec);
+}
+
+MYLOGGER_INLINE void ArgFormatter<const char*>::format(std::string& out, const char* value, const FormatSpec& spec) {
+    ArgFormatter<std::string_view>::format(out, value ? value : "(null)", spec);
+}
+
+MYLOGGER_INLINE void ArgFormatter<bool>::format(std::string& out, bool value, const FormatSpec& spec) {
+    if (spec.type != '\0' && spec.type != 's') {
+        ArgFormatter<unsigned int>::format(out, value ? 1 : 0, spec);
+    } else {
+        spec.check("s", false, "a bool");
+        ArgFormatter<std::string_view>::format(out, value ? "true" : "false", spec);
+    }
+}
+
+MYLOGGER_INLINE void ArgFormatter<char>::format(std::string& out, char value, const FormatSpec& spec) {
+    if (spec.type != '\0' && spec.type != 'c') {
+        ArgFormatter<int>::format(out, value, spec);
+    } else {
+        spec.check("c", false, "a char");
+        spec.pad(out, &value, 1);
+    }
+}
+
+MYLOGGER_INLINE void ArgFormatter<std::nullptr_t>::format(std::string& out, std::nullptr_t, const FormatSpec& spec) {
+    ArgFormatter<const void*>::format(out, nullptr, spec);
+}
+
+#endif // MYLOGGER_ARGFORMATTER_INL_HPP
@@ -0,0 +1,347 @@
+// 参数格式化: 按照占位符中的格式说明将日志参数转换为字符串。
+// 整数、浮点数、bool、字符、字符串、枚举与指针在编译期选择基于 std::to_chars 或直接拷贝的实现，
+// 其他类型回退到 operator<<. 用户可以为自定义类型特化 ArgFormatter:
+//
+//     template <>
+//     struct ArgFormatter<Point> {
+//         static void format(std::string& out, const Point& point, const FormatSpec& spec) {
+//             std::string text = "(" + std::to_string(point.x) + ", " + std::to_string(point.y) + ")";
+//             spec.pad(out, text.data(), text.size()); // 处理宽度与对齐
+//         }
+//     };
+//
+// 格式说明与 std::format 相同: {[index]:[[fill]align][sign][#][0][width][.precision][type]},
+// 例如 {:x}、{:.3f}、{:>8}、{1:08.2f}. 类型与参数不匹配(如 {:d} 用于浮点数)或为整数指定精度时抛出
+// std::runtime_error, 自定义类型可以通过 FormatSpec::check() 作同样的检查。
+
+#pragma once
+
+#ifndef MYLOGGER_ARGFORMATTER_HPP
+#define MYLOGGER_ARGFORMATTER_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+
+// 占位符中 ':' 之后的格式说明
+struct FormatSpec {
+    char fill = ' ';        // 填充字符
+    char align = '\0';      // 对齐方式 '<' '>' '^', '\0' 表示使用类型的默认对齐方式
+    char sign = '-';        // 符号 '+' '-' ' '
+    bool alternate = false; // '#': 为整数添加 0x、0b、0 前缀
+    bool zero_pad = false;  // '0': 在符号、前缀与数字之间填充 0
+    int width = 0;          // 最小宽度
+    int precision = -1;     // 精度，-1 表示未指定
+    char type = '\0';       // 类型，如 'd' 'x' 'f' 'e' 's' 'p', '\0' 表示未指定
+
+    // 解析格式说明(不含 ':')，格式错误或类型未知时抛出 std::runtime_error
+    static FormatSpec parse(const std::string& text);
+
+    // 检查类型是否属于 types(未指定类型总是允许)以及是否允许指定精度，不满足时抛出 std::runtime_error.
+    // kind 为参数种类的名称，用于错误信息
+    void check(const char* types, bool allow_precision, const char* kind) const;
+
+    // 按照宽度与对齐方式将 text 追加到 out 中，未指定对齐方式时使用 default_align
+    void pad(std::string& out, const char* text, std::size_t size, char default_align = '<') const;
+
+    // 追加数字: 默认右对齐，'0' 标志的填充位于符号、前缀与数字之间。sign 为 '\0' 表示不输出符号。
+    void padNumber(std::string& out, char sign, const char* prefix, const char* digits, std::size_t size) const;
+};
+
+// 默认实现: 通过 operator<< 转换为字符串，再按字符串处理类型、宽度、对齐与精度
+template <typename T, typename Enable = void>
+struct ArgFormatter {
+    static void format(std::string& out, const T& value, const FormatSpec& spec);
+};
+
+// 整数(bool 与 char 除外): 支持 d x X o b B c 类型，不支持精度
+template <typename T>
+struct ArgFormatter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                        !std::is_same_v<T, char>>> {
+    static void format(std::string& out, T value, const FormatSpec& spec);
+};
+
+// 浮点数: 支持 f F e E g G 类型，未指定类型与精度时输出可以精确还原的最短表示
+template <typename T>
+struct ArgFormatter<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static void format(std::string& out, T value, const FormatSpec& spec);
+};
+
+// 字符串: 支持 s 类型，精度表示最多输出的字符数
+template <>
+struct ArgFormatter<std::string_view> {
+    static void format(std::string& out, std::string_view value, const FormatSpec& spec);
+};
+
+template <>
+struct ArgFormatter<std::string> {
+    static void format(std::string& out, const std::string& value, const FormatSpec& spec);
+};
+
+template <>
+struct ArgFormatter<const char*> {
+    static void format(std::string& out, const char* value, const FormatSpec& spec);
+};
+
+template <>
+struct ArgFormatter<char*> : ArgFormatter<const char*> {};
+
+template <std::size_t N>
+struct ArgFormatter<char[N]> : ArgFormatter<const char*> {};
+
+// bool: 输出 true/false (s 类型), 指定整数类型时输出 1/0
+template <>
+struct ArgFormatter<bool> {
+    static void format(std::string& out, bool value, const FormatSpec& spec);
+};
+
+// char: 输出字符本身 (c 类型), 指定整数类型时输出其数值
+template <>
+struct ArgFormatter<char> {
+    static void format(std::string& out, char value, const FormatSpec& spec);
+};
+
+// 指针: 以十六进制输出地址，支持 p x X 类型
+template <typename T>
+struct ArgFormatter<T*> {
+    static void format(std::string& out, const T* value, const FormatSpec& spec);
+};
+
+template <>
+struct ArgFormatter<std::nullptr_t> {
+    static void format(std::string& out, std::nullptr_t value, const FormatSpec& spec);
+};
+
+// 判断类型是否可以通过 operator<< 输出
+template <typename T, typename = void>
+struct HasOstreamOperator : std::false_type {};
+
+template <typename T>
+struct HasOstreamOperator<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const T&>())>>
+    : std::true_type {};
+
+// 没有定义 operator<< 的枚举: 输出其底层整数值
+template <typename T>
+struct ArgFormatter<T, std::enable_if_t<std::is_enum_v<T> && !HasOstreamOperator<T>::value>> {
+    static void format(std::string& out, T value, const FormatSpec& spec);
+};
+
+// 延迟求值的参数: 不带参数调用后返回值不为 void 的可调用对象(lambda、函数指针等)。
+// 日志通过日志等级、负载采样与限流的检查之后才在调用线程上求值，被过滤掉的日志不产生任何开销。
+template <typename T, typename = void>
+struct LazyArg {
+    using Type = T;
+    static const T& resolve(const T& value) {
+        return value;
+    }
+};
+
+template <typename T>
+struct LazyArg<T, std::enable_if_t<std::is_invocable_v<const T&> && !std::is_void_v<std::invoke_result_t<const T&>>>> {
+    using Type = std::decay_t<std::invoke_result_t<const T&>>;
+    static Type resolve(const T& callable) {
+        return callable();
+    }
+};
+
+// 推迟到格式化线程求值的参数，由 Logger::deferred() 创建。可调用对象会被拷贝到格式化任务中，
+// 因此只能按值捕获(或捕获不会被修改、生命周期足够长的数据)。
+template <typename F>
+struct DeferredArg {
+    F callable;
+};
+
+template <typename T>
+struct IsDeferredArg : std::false_type {};
+
+template <typename F>
+struct IsDeferredArg<DeferredArg<F>> : std::true_type {};
+
+template <typename F>
+struct ArgFormatter<DeferredArg<F>> {
+    static void format(std::string& out, const DeferredArg<F>& value, const FormatSpec& spec) {
+        using Result = std::decay_t<std::invoke_result_t<const F&>>;
+        ArgFormatter<Result>::format(out, value.callable(), spec);
+    }
+};
+
+// 类型擦除的参数引用，使 Formatter 的解析逻辑不必随参数类型实例化
+struct FormatArg {
+    const void* value;
+    void (*format)(std::string& out, const void* value, const FormatSpec& spec);
+
+    template <typename T>
+    static FormatArg of(const T& value);
+};
+
+template <typename T, typename Enable>
+void ArgFormatter<T, Enable>::format(std::string& out, const T& value, const FormatSpec& spec) {
+    std::ostringstream oss;
+    oss << value;
+    ArgFormatter<std::string_view>::format(out, oss.str(), spec);
+}
+
+template <typename T>
+void ArgFormatter<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                      !std::is_same_v<T, char>>>::format(std::string& out, T value,
+                                                                          const FormatSpec& spec) {
+    spec.check("dxXobBc", false, "an integer");
+    if (spec.type == 'c') {
+        char c = static_cast<char>(value);
+        spec.pad(out, &c, 1);
+        return;
+    }
+
+    // 取绝对值，符号单独处理，以便在符号与数字之间填充 0
+    using Unsigned = std::make_unsigned_t<T>;
+    Unsigned magnitude = static_cast<Unsigned>(value);
+    char sign = spec.sign == '-' ? '\0' : spec.sign;
+    if constexpr (std::is_signed_v<T>) {
+        if (value < 0) {
+            magnitude = static_cast<Unsigned>(Unsigned(0) - magnitude);
+            sign = '-';
+        }
+    }
+
+    int base = 10;
+    const char* prefix = "";
+    switch (spec.type) {
+    case 'x':
+        base = 16;
+        prefix = "0x";
+        break;
+    case 'X':
+        base = 16;
+        prefix = "0X";
+        break;
+    case 'b':
+        base = 2;
+        prefix = "0b";
+        break;
+    case 'B':
+        base = 2;
+        prefix = "0B";
+        break;
+    case 'o':
+        base = 8;
+        prefix = "0";
+        break;
+    }
+
+    char digits[std::numeric_limits<unsigned long long>::digits];
+    auto result = std::to_chars(digits, digits + sizeof(digits), static_cast<unsigned long long>(magnitude), base);
+    if (spec.type == 'X') {
+        for (char* c = digits; c != result.ptr; c++) {
+            *c = static_cast<char>(std::toupper(static_cast<unsigned char>(*c)));
+        }
+    }
+
+    spec.padNumber(out, sign, spec.alternate ? prefix : "", digits, result.ptr - digits);
+}
+
+template <typename T>
+void ArgFormatter<T, std::enable_if_t<std::is_floating_point_v<T>>>::format(std::string& out, T value,
+                                                                            const FormatSpec& spec) {
+    spec.check("fFeEgG", true, "a floating-point");
+    char sign = spec.sign == '-' ? '\0' : spec.sign;
+    // 不包含 <cmath>: 它会在全局命名空间中声明 log(), 与用户常用的 using log = Logger 冲突
+    bool is_nan = value != value;
+    bool is_negative = value < 0 || (value == 0 && T(1) / value < 0);
+    if (is_negative) {
+        sign = '-';
+        value = -value;
+    }
+
+    bool upper = spec.type == 'F' || spec.type == 'E' || spec.type == 'G';
+
+    // nan 与 inf 不填充 0
+    if (is_nan || value - value != 0) {
+        const char* text = is_nan ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+        FormatSpec no_zero = spec;
+        no_zero.zero_pad = false;
+        no_zero.padNumber(out, sign, "", text, 3);
+        return;
+    }
+
+    // 转换到 [first, last) 中
+    auto convert = [&](char* first, char* last) {
+        int precision = spec.precision;
+        switch (spec.type) {
+        case 'f':
+        case 'F':
+            return std::to_chars(first, last, value, std::chars_format::fixed, precision < 0 ? 6 : precision);
+        case 'e':
+        case 'E':
+            return std::to_chars(first, last, value, std::chars_format::scientific,
+                                 precision < 0 ? 6 : precision);
+        case 'g':
+        case 'G':
+            return std::to_chars(first, last, value, std::chars_format::general, precision < 0 ? 6 : precision);
+        default:
+            return precision < 0 ? std::to_chars(first, last, value)
+                                 : std::to_chars(first, last, value, std::chars_format::general, precision);
+        }
+    };
+
+    char stack_buffer[128];
+    std::string heap_buffer;
+    char* first = stack_buffer;
+    auto result = convert(stack_buffer, stack_buffer + sizeof(stack_buffer));
+    if (result.ec != std::errc()) {
+        // 定点格式的大数或很高的精度: 改用足够大的堆缓冲区
+        heap_buffer.resize(std::numeric_limits<T>::max_exponent10 + std::max(spec.precision, 6) + 16);
+        first = &heap_buffer[0];
+        result = convert(first, first + heap_buffer.size());
+    }
+
+    if (upper) {
+        for (char* c = first; c != result.ptr; c++) {
+            *c = static_cast<char>(std::toupper(static_cast<unsigned char>(*c)));
+        }
+    }
+
+    spec.padNumber(out, sign, "", first, result.ptr - first);
+}
+
+template <typename T>
+void ArgFormatter<T*>::format(std::string& out, const T* value, const FormatSpec& spec) {
+    spec.check("pxX", false, "a pointer");
+    FormatSpec pointer_spec = spec;
+    pointer_spec.type = spec.type == 'X' ? 'X' : 'x';
+    pointer_spec.alternate = true;
+    ArgFormatter<std::uintptr_t>::format(out, reinterpret_cast<std::uintptr_t>(value), pointer_spec);
+}
+
+template <typename T>
+void ArgFormatter<T, std::enable_if_t<std::is_enum_v<T> && !HasOstreamOperator<T>::value>>::format(
+    std::string& out, T value, const FormatSpec& spec) {
+    using Underlying = std::underlying_type_t<T>;
+    ArgFormatter<Underlying>::format(out, static_cast<Underlying>(value), spec);
+}
+
+template <typename T>
+FormatArg FormatArg::of(const T& value) {
+    return {&value, [](std::string& out, const void* value, const FormatSpec& spec) {
+                ArgFormatter<T>::format(out, *static_cast<const T*>(value), spec);
+            }};
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_ARGFORMATTER_INL_HPP
+#include "argformatter-inl.hpp"
+MYLOGGER_ARGFORMATTER_INL_HPP
+#endif // MYLOGGER_ARGFORMATTER_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_ARGFORMATTER_HPP
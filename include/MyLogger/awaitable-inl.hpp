@@ -0,0 +1,84 @@
+// awaitable 相关类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_AWAITABLE_INL_HPP
+#define MYLOGGER_AWAITABLE_INL_HPP
+
+#ifndef MYLOGGER_AWAITABLE_HPP
+#include "awaitable.hpp"
+#endif // MYLOGGER_AWAITABLE_HPP
+
+#include <utility>
+
+#include "threadspool.hpp"
+
+inline std::mutex& AsyncResumer::mutex() {
+    static std::mutex mtx;
+    static const bool registered = (ThreadsPool::addForkLock(mtx), true);
+    (void)registered;
+    return mtx;
+}
+
+inline AsyncResumer::Function& AsyncResumer::function() {
+    static Function instance;
+    return instance;
+}
+
+inline void AsyncResumer::set(Function resumer) {
+    std::unique_lock<std::mutex> lock(mutex());
+    function() = std::move(resumer);
+}
+
+inline void AsyncResumer::resume(std::coroutine_handle<> handle) {
+    // 只在挂起后恢复时调用，拷贝一份再调用，避免在持锁时执行用户代码
+    Function resumer;
+    {
+        std::unique_lock<std::mutex> lock(mutex());
+        resumer = function();
+    }
+    if (resumer) {
+        resumer(handle);
+    } else {
+        handle.resume();
+    }
+}
+
+inline FlushAwaitable::FlushAwaitable(Post post) : m_post(post) {
+}
+
+inline bool FlushAwaitable::await_ready() const noexcept {
+    return false;
+}
+
+inline void FlushAwaitable::await_suspend(std::coroutine_handle<> handle) const {
+    m_post([handle] { AsyncResumer::resume(handle); });
+}
+
+inline void FlushAwaitable::await_resume() const noexcept {
+}
+
+template <typename Submit>
+LogAwaitable<Submit>::LogAwaitable(bool enabled, Submit submit) : m_pending(enabled), m_submit(std::move(submit)) {
+}
+
+template <typename Submit>
+bool LogAwaitable<Submit>::await_ready() const {
+    return !m_pending || ThreadsPool::getThreadsPool().hasAsyncSpace();
+}
+
+template <typename Submit>
+bool LogAwaitable<Submit>::await_suspend(std::coroutine_handle<> handle) const {
+    // 注册前队列可能已经腾出空间，此时不挂起
+    return ThreadsPool::getThreadsPool().waitForAsyncSpace([handle] { AsyncResumer::resume(handle); });
+}
+
+template <typename Submit>
+void LogAwaitable<Submit>::await_resume() {
+    if (m_pending) {
+        m_pending = false;
+        m_submit();
+    }
+}
+
+#endif // MYLOGGER_AWAITABLE_INL_HPP
@@ -0,0 +1,94 @@
+// C++20 协程接口: co_await Logger::flushAsync() 与 co_await Logger::infoAsync(...) 等。
+// 格式化队列长度达到 BackendOptions::async_queue_limit 时挂起调用协程而不是阻塞执行器线程，
+// 格式化线程腾出空间后再恢复协程并提交日志。flushAsync() 在之前提交的日志全部输出后恢复协程。
+//
+// 协程默认在后台线程中直接恢复。恢复后的代码不应执行耗时操作，也不能调用阻塞的 Logger::flush();
+// 可以通过 Logger::setAsyncResumer() 将协程投递回自己的执行器，例如:
+//
+//     Logger::setAsyncResumer([&io](std::coroutine_handle<> handle) { asio::post(io, handle); });
+//
+// 仅在编译器支持协程(-std=c++20)时可用，此时定义 MYLOGGER_HAS_COROUTINES; C++17 下本文件为空。
+
+#pragma once
+
+#ifndef MYLOGGER_AWAITABLE_HPP
+#define MYLOGGER_AWAITABLE_HPP
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define MYLOGGER_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef MYLOGGER_HAS_COROUTINES
+
+#include <coroutine>
+#include <functional>
+#include <mutex>
+
+// 协程的恢复方式
+class AsyncResumer {
+  private:
+    // 友元类声明，仅允许 Logger 类与 awaitable 类访问私有成员
+    friend class Logger;
+    friend class FlushAwaitable;
+    template <typename Submit>
+    friend class LogAwaitable;
+
+    using Function = std::function<void(std::coroutine_handle<>)>;
+
+  private:
+    static std::mutex& mutex();
+    static Function& function(); // 为空时在当前线程中直接恢复
+
+    static void set(Function resumer);
+    static void resume(std::coroutine_handle<> handle);
+};
+
+// Logger::flushAsync() 的返回值: 之前提交的日志全部写入控制台与文件后恢复协程
+class FlushAwaitable {
+  private:
+    friend class Logger;
+
+    // 提交一次刷新，完成后在输出线程中调用 on_done
+    using Post = void (*)(std::function<void(void)> on_done);
+
+  private:
+    Post m_post;
+
+  private:
+    explicit FlushAwaitable(Post post);
+
+  public:
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept;
+};
+
+// Logger::infoAsync() 等的返回值: 格式化队列未满时直接提交，已满时挂起，直到格式化线程腾出空间
+template <typename Submit>
+class LogAwaitable {
+  private:
+    friend class Logger;
+
+  private:
+    bool m_pending;  // 日志尚未提交。被日志等级过滤掉的日志构造时即为 false, 不会挂起。
+    Submit m_submit; // 以同步接口提交日志
+
+  private:
+    LogAwaitable(bool enabled, Submit submit);
+
+  public:
+    bool await_ready() const;
+    bool await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume();
+};
+
+#ifndef MYLOGGER_AWAITABLE_INL_HPP
+#include "awaitable-inl.hpp"
+MYLOGGER_AWAITABLE_INL_HPP
+#endif // MYLOGGER_AWAITABLE_INL_HPP
+
+#endif // MYLOGGER_HAS_COROUTINES
+
+#endif // MYLOGGER_AWAITABLE_HPP
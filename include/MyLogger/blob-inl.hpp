@@ -0,0 +1,147 @@
+// blob 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_BLOB_INL_HPP
+#define MYLOGGER_BLOB_INL_HPP
+
+#ifndef MYLOGGER_BLOB_HPP
+#include "blob.hpp"
+#endif // MYLOGGER_BLOB_HPP
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+MYLOGGER_INLINE Blob::Blob(const void* data, std::size_t size, BlobFormat format)
+    : m_data(size ? new unsigned char[size] : nullptr), m_size(size), m_format(format) {
+    if (size)
+        std::memcpy(m_data.get(), data, size);
+}
+
+MYLOGGER_INLINE std::size_t Blob::encodedSize() const {
+    if (m_size == 0)
+        return 0;
+    switch (m_format) {
+    case BlobFormat::HEX:
+        return m_size * 2 + 1;
+    case BlobFormat::BASE64:
+        return (m_size + 2) / 3 * 4 + 1;
+    default:
+        // 完整的行为 79 个字符，最后一行只缺少可打印字符部分
+        return m_size / 16 * 79 + (m_size % 16 ? 63 + m_size % 16 : 0);
+    }
+}
+
+MYLOGGER_INLINE void Blob::appendTo(std::string& out) const {
+    std::size_t size = encodedSize();
+    if (size == 0)
+        return;
+
+    std::size_t offset = out.size();
+    out.resize(offset + size);
+    char* p = &out[offset];
+    switch (m_format) {
+    case BlobFormat::HEX:
+        encodeHex(m_data.get(), m_size, p);
+        p[size - 1] = '\n';
+        break;
+    case BlobFormat::BASE64:
+        encodeBase64(m_data.get(), m_size, p);
+        p[size - 1] = '\n';
+        break;
+    default:
+        encodeHexdump(m_data.get(), m_size, p);
+        break;
+    }
+}
+
+MYLOGGER_INLINE void Blob::encodeHex(const unsigned char* in, std::size_t size, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // 每次 16 字节: 拆分高低半字节，0-9 加 '0'，10-15 再加上 'a' - '0' - 10，交错后得到 32 个字符
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i gap = _mm_set1_epi8('a' - '0' - 10);
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+        __m128i lo = _mm_and_si128(bytes, mask);
+        hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), gap));
+        lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), gap));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+#endif
+    for (; i < size; i++) {
+        out[i * 2] = digits[in[i] >> 4];
+        out[i * 2 + 1] = digits[in[i] & 0x0f];
+    }
+}
+
+MYLOGGER_INLINE void Blob::encodeHexdump(const unsigned char* in, std::size_t size, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (std::size_t line = 0; line < size; line += 16) {
+        std::size_t count = size - line < 16 ? size - line : 16;
+
+        // 偏移
+        for (int shift = 28; shift >= 0; shift -= 4)
+            *out++ = digits[(line >> shift) & 0x0f];
+        *out++ = ' ';
+        *out++ = ' ';
+
+        // 整行一次编码后按 "xx " 展开，第 8 个字节之后多一个空格; 不足 16 字节时以空格补齐
+        char hex[32];
+        encodeHex(in + line, count, hex);
+        for (std::size_t i = 0; i < 16; i++) {
+            if (i < count) {
+                out[0] = hex[i * 2];
+                out[1] = hex[i * 2 + 1];
+            } else {
+                out[0] = ' ';
+                out[1] = ' ';
+            }
+            out[2] = ' ';
+            out += 3;
+            if (i == 7)
+                *out++ = ' ';
+        }
+
+        *out++ = ' ';
+        *out++ = '|';
+        for (std::size_t i = 0; i < count; i++) {
+            unsigned char c = in[line + i];
+            *out++ = c >= 0x20 && c < 0x7f ? static_cast<char>(c) : '.';
+        }
+        *out++ = '|';
+        *out++ = '\n';
+    }
+}
+
+MYLOGGER_INLINE void Blob::encodeBase64(const unsigned char* in, std::size_t size, char* out) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        unsigned int v = static_cast<unsigned int>(in[i]) << 16 | static_cast<unsigned int>(in[i + 1]) << 8 | in[i + 2];
+        out[0] = table[v >> 18];
+        out[1] = table[(v >> 12) & 0x3f];
+        out[2] = table[(v >> 6) & 0x3f];
+        out[3] = table[v & 0x3f];
+        out += 4;
+    }
+    if (i < size) {
+        unsigned int v = static_cast<unsigned int>(in[i]) << 16;
+        if (i + 1 < size)
+            v |= static_cast<unsigned int>(in[i + 1]) << 8;
+        out[0] = table[v >> 18];
+        out[1] = table[(v >> 12) & 0x3f];
+        out[2] = i + 1 < size ? table[(v >> 6) & 0x3f] : '=';
+        out[3] = '=';
+    }
+}
+
+#endif // MYLOGGER_BLOB_INL_HPP
@@ -0,0 +1,63 @@
+// 二进制数据(如网络报文)的日志输出，通过 Logger::blob() 与 Logger::hexdump() 使用。
+//
+// 数据只在调用日志函数时拷贝一次，保存在引用计数的 Blob 中随任务传递，不经过 Formatter 的参数展开与转义处理;
+// 输出线程将编码结果直接追加到自己的输出缓冲区中，不产生中间字符串。十六进制编码在支持 SSE2 时每次处理 16 字节。
+//
+// 输出格式(message 格式化后的一行日志之后):
+//     HEXDUMP: 与 hexdump -C 相同，每行 16 字节，包含偏移、十六进制与可打印字符
+//              00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 00 ff  |Hello, world!...|
+//     HEX:     连续的小写十六进制，末尾换行
+//     BASE64:  标准 Base64(RFC 4648，带填充)，末尾换行
+
+#pragma once
+
+#ifndef MYLOGGER_BLOB_HPP
+#define MYLOGGER_BLOB_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "common.hpp"
+
+enum class BlobFormat { HEXDUMP, HEX, BASE64 };
+
+class Blob {
+  private:
+    // 友元类声明，仅允许 Logger 类与 LogWriter 类访问私有成员
+    friend class Logger;
+    friend class LogWriter;
+
+  private:
+    std::unique_ptr<unsigned char[]> m_data;
+    std::size_t m_size;
+    BlobFormat m_format;
+
+  private:
+    // 拷贝 data 的 size 个字节
+    Blob(const void* data, std::size_t size, BlobFormat format);
+    Blob(const Blob&) = delete;
+    Blob& operator=(const Blob&) = delete;
+
+    // 编码后的字节数
+    std::size_t encodedSize() const;
+
+    // 将编码结果直接追加到 out 末尾
+    void appendTo(std::string& out) const;
+
+  private:
+    // 将 size 个字节编码为 2 * size 个小写十六进制字符
+    static void encodeHex(const unsigned char* in, std::size_t size, char* out);
+
+    static void encodeHexdump(const unsigned char* in, std::size_t size, char* out);
+    static void encodeBase64(const unsigned char* in, std::size_t size, char* out);
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_BLOB_INL_HPP
+#include "blob-inl.hpp"
+MYLOGGER_BLOB_INL_HPP
+#endif // MYLOGGER_BLOB_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_BLOB_HPP
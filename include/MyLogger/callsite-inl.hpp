@@ -0,0 +1,84 @@
+// callsite 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_CALLSITE_INL_HPP
+#define MYLOGGER_CALLSITE_INL_HPP
+
+#ifndef MYLOGGER_CALLSITE_HPP
+#include "callsite.hpp"
+#endif // MYLOGGER_CALLSITE_HPP
+
+#include <algorithm>
+#include <chrono>
+
+MYLOGGER_INLINE CallSite::CallSite(double rate, unsigned int burst, const SourceLocation& location)
+    : m_interval_ns(rate > 0 ? static_cast<std::int64_t>(1e9 / rate) : 0),
+      m_burst_ns(m_interval_ns * (burst > 0 ? burst - 1 : 0)), m_tat_ns(0), m_suppressed(0),
+      m_level(LogLevel::INFO), m_sinks(0), m_next(head().load(std::memory_order_relaxed)), m_location(location) {
+    if (m_interval_ns != 0)
+        rateLimited().store(true, std::memory_order_relaxed);
+    while (!head().compare_exchange_weak(m_next, this, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+MYLOGGER_INLINE std::atomic<CallSite*>& CallSite::head() {
+    static std::atomic<CallSite*> instance(nullptr);
+    return instance;
+}
+
+MYLOGGER_INLINE std::atomic<bool>& CallSite::rateLimited() {
+    static std::atomic<bool> instance(false);
+    return instance;
+}
+
+MYLOGGER_INLINE const SourceLocation*& CallSite::current() {
+    static thread_local const SourceLocation* location = nullptr;
+    return location;
+}
+
+MYLOGGER_INLINE CallSite::Scope::Scope(const SourceLocation* location) : m_previous(current()) {
+    current() = location;
+}
+
+MYLOGGER_INLINE CallSite::Scope::~Scope() {
+    current() = m_previous;
+}
+
+MYLOGGER_INLINE bool CallSite::allow(LogLevel level, unsigned int sinks) {
+    if (m_interval_ns == 0)
+        return true;
+
+    std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+
+    std::int64_t tat = m_tat_ns.load(std::memory_order_relaxed);
+    while (true) {
+        std::int64_t start = std::max(tat, now);
+        if (start - now > m_burst_ns) {
+            // 令牌耗尽: 仅累加计数，不做任何分配。等级与输出目标不变时只读不写
+            if (m_level.load(std::memory_order_relaxed) != level)
+                m_level.store(level, std::memory_order_relaxed);
+            if (m_sinks.load(std::memory_order_relaxed) != sinks)
+                m_sinks.store(sinks, std::memory_order_relaxed);
+            m_suppressed.fetch_add(1, std::memory_order_release);
+            return false;
+        }
+        if (m_tat_ns.compare_exchange_weak(tat, start + m_interval_ns, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+MYLOGGER_INLINE unsigned long long CallSite::takeSuppressed() {
+    // 先读一次，避免在没有丢弃时也产生写操作
+    if (m_suppressed.load(std::memory_order_relaxed) == 0)
+        return 0;
+    return m_suppressed.exchange(0, std::memory_order_acquire);
+}
+
+MYLOGGER_INLINE std::int64_t CallSite::admitTime() const {
+    return m_tat_ns.load(std::memory_order_relaxed) - m_burst_ns;
+}
+
+#endif // MYLOGGER_CALLSITE_INL_HPP
@@ -0,0 +1,113 @@
+// 调用点(call site)状态，用于按调用点进行日志限流，并记录调用点的源码位置。
+// 每个调用点对应一个静态的 CallSite 对象，只能通过 CallSite::get() 创建，通常由 MYLOGGER_CALLSITE 或
+// MYLOGGER_HERE 宏展开。
+
+#pragma once
+
+#ifndef MYLOGGER_CALLSITE_HPP
+#define MYLOGGER_CALLSITE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "common.hpp"
+#include "loglevel.hpp"
+
+// 源码位置，均指向静态存储期的字符串，因此日志只需保存一个指针
+struct SourceLocation {
+    const char* file = nullptr;     // __FILE__, 为空表示未知
+    unsigned int line = 0;          // __LINE__
+    const char* function = nullptr; // __func__
+};
+
+class CallSite {
+  private:
+    // 友元类声明，仅允许 Logger 与 Formatter 类访问私有成员
+    friend class Logger;
+    friend class Formatter;
+
+  private:
+    // 令牌桶参数，以 GCRA 算法实现，只需一个原子变量即可无锁地完成判断
+    std::int64_t m_interval_ns; // 每产生一个令牌所需的时间(纳秒)，0 表示不限流
+    std::int64_t m_burst_ns;    // 允许的突发量对应的时间容差(纳秒)
+
+    std::atomic<std::int64_t> m_tat_ns;           // 理论到达时间 (Theoretical Arrival Time)
+    std::atomic<unsigned long long> m_suppressed; // 自上次输出以来被丢弃的日志条数
+    std::atomic<LogLevel> m_level;                // 最近一条被丢弃的日志的等级，用于输出汇总信息
+    std::atomic<unsigned int> m_sinks;            // 最近一条被丢弃的日志的输出目标(Logger::kConsole 等)
+
+    CallSite* m_next; // 所有调用点构成的单向链表，用于汇总统计
+
+    SourceLocation m_location; // 调用点的源码位置
+
+  public:
+    CallSite(const CallSite&) = delete;
+    CallSite& operator=(const CallSite&) = delete;
+
+    // 返回 Tag 对应的静态调用点，首次调用时构造。调用点链入 head() 且不会被移除，日志中也只保存指向其源码位置的
+    // 指针，因此必须具有静态存储期: 构造函数是私有的，调用点只能由此创建。Tag 通常为宏展开处定义的局部类型。
+    template <typename Tag>
+    static CallSite& get(double rate, unsigned int burst, const SourceLocation& location);
+
+  private:
+    // rate: 每秒允许的日志条数，<= 0 表示不限流; burst: 允许的突发条数; location: 调用点的源码位置
+    CallSite(double rate, unsigned int burst, const SourceLocation& location);
+
+    // 判断当前日志是否允许输出，不允许时累加丢弃计数并记下 level 与 sinks. 仅包含一次时钟读取与一次 CAS。
+    bool allow(LogLevel level, unsigned int sinks);
+
+    // 取出并清零丢弃计数，用于输出汇总信息
+    unsigned long long takeSuppressed();
+
+    // 下一条日志最早被允许输出的时间(steady_clock, 纳秒)。此后仍未输出的丢弃计数由格式化线程输出。
+    std::int64_t admitTime() const;
+
+    // 是否存在限流的调用点。存在时格式化线程定期检查各调用点，输出没有后续日志带出的丢弃计数。
+    static std::atomic<bool>& rateLimited();
+
+    // 所有调用点链表的头指针。调用点均为静态对象，只插入不删除，因此无需加锁。
+    static std::atomic<CallSite*>& head();
+
+    // 当前线程正在记录的日志所属调用点的源码位置，由 Logger 通过 Scope 设置，Formatter 在取出时读取
+    static const SourceLocation*& current();
+
+    // 在作用域内设置 current(), 离开作用域时(包括抛出异常时)恢复之前的值
+    class Scope {
+      private:
+        const SourceLocation* m_previous;
+
+      public:
+        explicit Scope(const SourceLocation* location);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+template <typename Tag>
+CallSite& CallSite::get(double rate, unsigned int burst, const SourceLocation& location) {
+    static CallSite instance(rate, burst, location);
+    return instance;
+}
+
+// 在调用处创建一个静态的 CallSite 对象，每个宏展开处拥有独立的限流状态，并记录源码位置供 {file}、{line}、{func} 使用
+// 用法: Logger::error(MYLOGGER_CALLSITE(100, 10), "message {}\n", arg);
+// __func__ 在 lambda 内部为 "operator()", 因此从外部作为参数传入; 每个展开处的局部类型各不相同
+#define MYLOGGER_CALLSITE(rate, burst)                                                                                 \
+    ([](const char* mylogger_function) -> CallSite& {                                                                  \
+        struct MyLoggerCallSiteTag {};                                                                                 \
+        return CallSite::get<MyLoggerCallSiteTag>(rate, burst, SourceLocation{__FILE__, __LINE__, mylogger_function}); \
+    }(__func__))
+
+// 只记录源码位置，不限流
+// 用法: Logger::error(MYLOGGER_HERE, "{file}:{line} {func}: message {}\n", arg);
+#define MYLOGGER_HERE MYLOGGER_CALLSITE(0, 1)
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_CALLSITE_INL_HPP
+#include "callsite-inl.hpp"
+MYLOGGER_CALLSITE_INL_HPP
+#endif // MYLOGGER_CALLSITE_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_CALLSITE_HPP
@@ -0,0 +1,20 @@
+// 编译方式的配置，所有头文件最先包含本文件。
+//
+// 默认为仅头文件: 所有实现都在 *-inl.hpp 中以 inline 函数定义，每个包含 logger.hpp 的翻译单元都要重新编译一遍。
+// 定义 MYLOGGER_COMPILED_LIB 并链接 MyLogger 库(CMake 选项 MYLOGGER_COMPILED_LIB=ON 时自动定义)后，
+// 头文件中只保留类的声明与模板，后台线程、格式化与输出等非模板实现在 src/MyLogger/*.cpp 中只编译一次。
+// 调用点只需实例化参数的捕获与 FormatArg 的构造，格式化字符串的解析与输出都通过类型擦除的接口完成。
+
+#pragma once
+
+#ifndef MYLOGGER_COMMON_HPP
+#define MYLOGGER_COMMON_HPP
+
+#ifdef MYLOGGER_COMPILED_LIB
+#define MYLOGGER_INLINE
+#else
+#define MYLOGGER_HEADER_ONLY
+#define MYLOGGER_INLINE inline
+#endif
+
+#endif // MYLOGGER_COMMON_HPP
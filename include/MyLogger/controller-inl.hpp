@@ -0,0 +1,311 @@
+// controller 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_CONTROLLER_INL_HPP
+#define MYLOGGER_CONTROLLER_INL_HPP
+
+#ifndef MYLOGGER_CONTROLLER_HPP
+#include "controller.hpp"
+#endif // MYLOGGER_CONTROLLER_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "logger.hpp"
+
+MYLOGGER_INLINE Controller::Controller() : m_socket_fd(-1), m_inotify_fd(-1), m_wakeup_fd(-1) {
+}
+
+MYLOGGER_INLINE Controller::~Controller() {
+#ifdef __linux__
+    if (m_thread.joinable()) {
+        std::uint64_t one = 1;
+        if (write(m_wakeup_fd, &one, sizeof(one)) < 0) {
+            // eventfd 计数器溢出才会失败，此时后台线程必然已被唤醒
+        }
+        m_thread.join();
+    }
+#endif
+    release();
+}
+
+MYLOGGER_INLINE void Controller::release() {
+#ifdef __linux__
+    if (m_socket_fd >= 0)
+        close(m_socket_fd);
+    if (!m_socket_path.empty())
+        unlink(m_socket_path.c_str());
+    if (m_inotify_fd >= 0)
+        close(m_inotify_fd);
+    if (m_wakeup_fd >= 0)
+        close(m_wakeup_fd);
+#endif
+    m_socket_fd = -1;
+    m_inotify_fd = -1;
+    m_wakeup_fd = -1;
+    m_socket_path.clear();
+    m_config_file.clear();
+    m_config_file_name.clear();
+}
+
+MYLOGGER_INLINE Controller& Controller::getController() {
+    static Controller instance;
+    return instance;
+}
+
+MYLOGGER_INLINE void Controller::start(const std::string& socket_path, const std::string& config_file) {
+#ifdef __linux__
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (m_thread.joinable()) {
+        throw std::runtime_error("Control channel has already been started.");
+    }
+
+    // 任何一步失败时关闭已经打开的描述符并删除已创建的套接字文件，之后可以再次调用 start()
+    try {
+        m_wakeup_fd = eventfd(0, EFD_CLOEXEC);
+        if (m_wakeup_fd < 0) {
+            throw std::runtime_error(std::string("Failed to create eventfd: ") + std::strerror(errno) + ".");
+        }
+
+        if (!socket_path.empty()) {
+            sockaddr_un addr{};
+            if (socket_path.size() >= sizeof(addr.sun_path)) {
+                throw std::runtime_error("Control socket path is too long: " + socket_path + ".");
+            }
+            addr.sun_family = AF_UNIX;
+            std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+            m_socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_socket_fd < 0) {
+                throw std::runtime_error(std::string("Failed to create control socket: ") + std::strerror(errno) +
+                                         ".");
+            }
+
+            unlink(socket_path.c_str()); // 删除上次运行遗留的套接字文件
+            if (bind(m_socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+                listen(m_socket_fd, 4) < 0) {
+                std::string reason = std::strerror(errno);
+                throw std::runtime_error("Failed to listen on control socket " + socket_path + ": " + reason + ".");
+            }
+            m_socket_path = socket_path;
+        }
+
+        if (!config_file.empty()) {
+            // 监视配置文件所在的目录而不是文件本身，以便正确处理编辑器"写入临时文件再重命名"的保存方式
+            auto pos = config_file.rfind('/');
+            std::string directory = pos == std::string::npos ? "." : config_file.substr(0, pos + 1);
+            m_config_file_name = pos == std::string::npos ? config_file : config_file.substr(pos + 1);
+            m_config_file = config_file;
+
+            m_inotify_fd = inotify_init1(IN_CLOEXEC);
+            if (m_inotify_fd < 0 ||
+                inotify_add_watch(m_inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+                throw std::runtime_error("Failed to watch config file " + config_file + ": " + std::strerror(errno) +
+                                         ".");
+            }
+
+            applyConfigFile();
+        }
+
+        m_thread = std::thread(&Controller::run, this);
+    } catch (...) {
+        release();
+        throw;
+    }
+#else
+    std::ignore = socket_path;
+    std::ignore = config_file;
+    throw std::runtime_error("Control channel is only supported on Linux.");
+#endif
+}
+
+MYLOGGER_INLINE void Controller::run() {
+#ifdef __linux__
+    while (true) {
+        pollfd fds[3];
+        nfds_t count = 0;
+        fds[count++] = {m_wakeup_fd, POLLIN, 0};
+        if (m_socket_fd >= 0)
+            fds[count++] = {m_socket_fd, POLLIN, 0};
+        if (m_inotify_fd >= 0)
+            fds[count++] = {m_inotify_fd, POLLIN, 0};
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        // 析构时通过 eventfd 唤醒
+        if (fds[0].revents & POLLIN)
+            return;
+
+        for (nfds_t i = 1; i < count; i++) {
+            if (!(fds[i].revents & POLLIN))
+                continue;
+
+            if (fds[i].fd == m_socket_fd) {
+                int client_fd = accept4(m_socket_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client_fd >= 0) {
+                    serveClient(client_fd);
+                    close(client_fd);
+                }
+            } else {
+                alignas(inotify_event) char buffer[4096];
+                ssize_t length = read(m_inotify_fd, buffer, sizeof(buffer));
+                bool changed = false;
+                for (ssize_t offset = 0; offset < length;) {
+                    auto* event = reinterpret_cast<inotify_event*>(buffer + offset);
+                    if (event->len > 0 && m_config_file_name == event->name)
+                        changed = true;
+                    offset += sizeof(inotify_event) + event->len;
+                }
+                if (changed)
+                    applyConfigFile();
+            }
+        }
+    }
+#endif
+}
+
+MYLOGGER_INLINE void Controller::serveClient(int client_fd) {
+#ifdef __linux__
+    // 客户端长时间不发送数据时放弃该连接，避免阻塞后续的控制请求
+    timeval timeout{1, 0};
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string pending;
+    char buffer[512];
+    while (true) {
+        ssize_t length = read(client_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            return;
+        pending.append(buffer, length);
+
+        std::string::size_type pos;
+        while ((pos = pending.find('\n')) != std::string::npos) {
+            std::string reply = execute(pending.substr(0, pos)) + "\n";
+            pending.erase(0, pos + 1);
+            if (send(client_fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+                return;
+        }
+    }
+#else
+    std::ignore = client_fd;
+#endif
+}
+
+MYLOGGER_INLINE void Controller::applyConfigFile() {
+    std::ifstream file(m_config_file);
+    std::string line;
+    while (std::getline(file, line)) {
+        execute(line);
+    }
+}
+
+MYLOGGER_INLINE std::string Controller::execute(const std::string& command) {
+    std::istringstream iss(command);
+    std::string name;
+    if (!(iss >> name) || name[0] == '#')
+        return "OK";
+
+    std::string value;
+    iss >> value;
+
+    auto parseSwitch = [&](bool& result) -> bool {
+        if (value == "on" || value == "true" || value == "1") {
+            result = true;
+            return true;
+        }
+        if (value == "off" || value == "false" || value == "0") {
+            result = false;
+            return true;
+        }
+        return false;
+    };
+
+    try {
+        if (name == "level") {
+            if (value == "DEBUG" || value == "debug") {
+                Logger::setLevel(LogLevel::DEBUG);
+            } else if (value == "INFO" || value == "info") {
+                Logger::setLevel(LogLevel::INFO);
+            } else if (value == "WARNING" || value == "warning") {
+                Logger::setLevel(LogLevel::WARNING);
+            } else if (value == "ERROR" || value == "error") {
+                Logger::setLevel(LogLevel::ERROR);
+            } else {
+                return "ERROR invalid level: " + value;
+            }
+        } else if (name == "console" || name == "file") {
+            bool enabled;
+            if (!parseSwitch(enabled))
+                return "ERROR expected on/off: " + value;
+            if (name == "console") {
+                Logger::enableConsole(enabled);
+            } else {
+                Logger::enabledFile(enabled);
+            }
+        } else if (name == "file_name") {
+            if (value.empty())
+                return "ERROR missing file name";
+            Logger::setFile(value);
+        } else if (name == "sampling") {
+            std::string rate;
+            iss >> rate;
+            unsigned long long threshold = 0;
+            unsigned long long one_in = 0;
+            if (!parseNumber(value, threshold))
+                return "ERROR expected a queue threshold: " + value;
+            if (!rate.empty() && (!parseNumber(rate, one_in) || one_in > std::numeric_limits<unsigned int>::max()))
+                return "ERROR expected a sampling rate: " + rate;
+            Logger::setSampling(static_cast<std::size_t>(threshold), static_cast<unsigned int>(one_in));
+        } else if (name == "dedup") {
+            unsigned long long window = 0;
+            auto max_window = static_cast<unsigned long long>(std::chrono::milliseconds::max().count());
+            if (!parseNumber(value, window) || window > max_window)
+                return "ERROR expected a window in milliseconds: " + value;
+            Logger::setDedupWindow(std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(window)));
+        } else if (name == "stats") {
+            // 以 Prometheus 文本格式返回运行统计，最后一行为 "OK"
+            return Logger::stats().toPrometheus() + "OK";
+        } else {
+            return "ERROR unknown command: " + name;
+        }
+    } catch (const std::exception& e) {
+        return std::string("ERROR ") + e.what();
+    }
+
+    return "OK";
+}
+
+MYLOGGER_INLINE bool Controller::parseNumber(const std::string& text, unsigned long long& value) {
+    if (text.empty() || text.size() > std::numeric_limits<unsigned long long>::digits10)
+        return false;
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + static_cast<unsigned long long>(c - '0');
+    }
+    return true;
+}
+
+#endif // MYLOGGER_CONTROLLER_INL_HPP
@@ -0,0 +1,81 @@
+// 运行时控制通道: 通过本地 Unix 域套接字或被 inotify 监视的配置文件，在不重启进程的情况下修改日志配置。
+// 所有成员均设置为私有，只能通过 Logger 类进行操作。目前仅支持 Linux.
+//
+// 套接字与配置文件使用相同的文本命令，每行一条，'#' 开头的行为注释:
+//     level DEBUG|INFO|WARNING|ERROR
+//     console on|off
+//     file on|off
+//     file_name <path>
+//     sampling <queue_threshold> [one_in]
+//     dedup <milliseconds>
+//     stats
+// 套接字对每条命令回复一行 "OK" 或 "ERROR <原因>"; stats 命令在 "OK" 之前返回 Prometheus 文本格式的运行统计。
+
+#pragma once
+
+#ifndef MYLOGGER_CONTROLLER_HPP
+#define MYLOGGER_CONTROLLER_HPP
+
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common.hpp"
+
+class Controller {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+
+  private:
+    std::mutex m_mtx;
+    std::thread m_thread;
+
+    int m_socket_fd;  // 监听套接字，-1 表示未启用
+    int m_inotify_fd; // inotify 实例，-1 表示未启用
+    int m_wakeup_fd;  // eventfd, 用于在析构时唤醒后台线程
+
+    std::string m_socket_path;      // 套接字路径
+    std::string m_config_file;      // 被监视的配置文件
+    std::string m_config_file_name; // 配置文件名(不含目录)，用于匹配 inotify 事件
+
+  private:
+    Controller();
+    ~Controller();
+    Controller(const Controller&) = delete;
+    Controller& operator=(const Controller&) = delete;
+
+    static Controller& getController();
+
+  private:
+    // 启动后台线程。socket_path 与 config_file 可以为空，表示不启用对应的通道。只能成功调用一次,
+    // 失败时抛出 std::runtime_error 并释放已经打开的资源，可以再次调用。
+    void start(const std::string& socket_path, const std::string& config_file);
+
+    // 关闭所有文件描述符并删除套接字文件。后台线程未运行时才能调用。
+    void release();
+
+    // 后台线程主循环: 阻塞在 poll() 上，空闲时不消耗 CPU
+    void run();
+
+    // 处理一个客户端连接，逐行执行命令并回复结果
+    void serveClient(int client_fd);
+
+    // 读取并执行整个配置文件
+    void applyConfigFile();
+
+    // 执行单条命令，返回回复内容(不含换行)
+    static std::string execute(const std::string& command);
+
+    // 解析十进制的非负整数，text 含有其他字符或超出范围时返回 false
+    static bool parseNumber(const std::string& text, unsigned long long& value);
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_CONTROLLER_INL_HPP
+#include "controller-inl.hpp"
+MYLOGGER_CONTROLLER_INL_HPP
+#endif // MYLOGGER_CONTROLLER_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_CONTROLLER_HPP
@@ -0,0 +1,201 @@
+// fileindex 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_FILEINDEX_INL_HPP
+#define MYLOGGER_FILEINDEX_INL_HPP
+
+#ifndef MYLOGGER_FILEINDEX_HPP
+#include "fileindex.hpp"
+#endif // MYLOGGER_FILEINDEX_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+MYLOGGER_INLINE FileIndex::State::~State() {
+    for (auto& block : blocks)
+        closeBlock(block.first, block.second.entry);
+}
+
+MYLOGGER_INLINE FileIndex::State& FileIndex::state() {
+    static State instance;
+    return instance;
+}
+
+MYLOGGER_INLINE std::string FileIndex::indexFile(const std::string& log_file) {
+    return log_file + ".idx";
+}
+
+MYLOGGER_INLINE void FileIndex::setOptions(const FileIndexOptions& options) {
+    State& s = state();
+    std::unique_lock<std::mutex> lock(s.mtx);
+    s.new_options = options;
+    s.changed.store(true, std::memory_order_release);
+}
+
+MYLOGGER_INLINE bool FileIndex::enabled() {
+    State& s = state();
+    if (s.changed.load(std::memory_order_acquire)) {
+        std::unique_lock<std::mutex> lock(s.mtx);
+        s.options = s.new_options;
+        s.changed.store(false, std::memory_order_relaxed);
+    }
+    if (!s.options.enabled && !s.blocks.empty()) {
+        for (auto& block : s.blocks)
+            closeBlock(block.first, block.second.entry);
+        s.blocks.clear();
+    }
+    return s.options.enabled;
+}
+
+MYLOGGER_INLINE void FileIndex::record(const std::string& log_file, std::uint64_t offset, std::uint64_t size,
+                                       LogLevel level, std::chrono::system_clock::time_point time) {
+    State& s = state();
+    auto now = std::chrono::steady_clock::now();
+    auto it = s.blocks.find(log_file);
+
+    // 与当前块不连续(其间有其他进程写入)、块已满或时间跨度已到时结束当前块
+    if (it != s.blocks.end()) {
+        const Entry& entry = it->second.entry;
+        if (entry.offset + entry.size != offset || entry.size >= s.options.block_size ||
+            now - it->second.opened >= s.options.block_interval) {
+            closeBlock(log_file, entry);
+            s.blocks.erase(it);
+            it = s.blocks.end();
+        }
+    }
+
+    std::int64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    if (it == s.blocks.end()) {
+        Block block;
+        block.entry = Entry{offset, 0, time_ns, time_ns, 0, 0};
+        block.opened = now;
+        it = s.blocks.emplace(log_file, block).first;
+    }
+
+    // 日志的时间戳在调用时获取，不同线程的日志到达的顺序与时间戳的顺序不一定相同
+    Entry& entry = it->second.entry;
+    entry.size += size;
+    entry.first_time_ns = std::min(entry.first_time_ns, time_ns);
+    entry.last_time_ns = std::max(entry.last_time_ns, time_ns);
+    entry.levels |= 1u << static_cast<unsigned int>(level);
+    entry.count++;
+}
+
+MYLOGGER_INLINE void FileIndex::closeBlock(const std::string& log_file, const Entry& entry) {
+    std::string index_file = indexFile(log_file);
+
+    // 索引文件为空、格式不正确，或者最后一个块超出了日志文件的末尾时重新建立索引文件
+    bool reset = true;
+    {
+        std::ifstream in(index_file, std::ios::binary | std::ios::ate);
+        std::streamoff size = in.is_open() ? static_cast<std::streamoff>(in.tellg()) : 0;
+        Header header;
+        Entry last;
+        if (size >= static_cast<std::streamoff>(sizeof(Header)) && in.seekg(0) &&
+            in.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+            std::memcmp(header.magic, "MYLOGIX1", sizeof(header.magic)) == 0 && header.version == kVersion &&
+            header.entry_size == sizeof(Entry)) {
+            reset = false;
+            struct stat st;
+            if (size >= static_cast<std::streamoff>(sizeof(Header) + sizeof(Entry)) &&
+                in.seekg(size - static_cast<std::streamoff>(sizeof(Entry))) &&
+                in.read(reinterpret_cast<char*>(&last), sizeof(last)) && stat(log_file.c_str(), &st) == 0 &&
+                last.offset + last.size > static_cast<std::uint64_t>(st.st_size))
+                reset = true;
+        }
+    }
+
+    std::ofstream out(index_file, reset ? std::ios::binary | std::ios::trunc : std::ios::binary | std::ios::app);
+    if (!out.is_open())
+        return;
+    if (reset) {
+        Header header;
+        std::memcpy(header.magic, "MYLOGIX1", sizeof(header.magic));
+        header.version = kVersion;
+        header.entry_size = sizeof(Entry);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+}
+
+MYLOGGER_INLINE std::vector<FileIndex::Entry> FileIndex::load(const std::string& index_file) {
+    std::ifstream in(index_file, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open log index: " + index_file + ".");
+    }
+
+    Header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, "MYLOGIX1", sizeof(header.magic)) != 0 || header.version != kVersion ||
+        header.entry_size != sizeof(Entry)) {
+        throw std::runtime_error("Invalid log index: " + index_file + ".");
+    }
+
+    std::vector<Entry> entries;
+    Entry entry;
+    while (in.read(reinterpret_cast<char*>(&entry), sizeof(entry)))
+        entries.push_back(entry);
+    return entries;
+}
+
+MYLOGGER_INLINE std::vector<FileIndex::Range> FileIndex::query(const std::string& log_file,
+                                                               std::chrono::system_clock::time_point from,
+                                                               std::chrono::system_clock::time_point to,
+                                                               std::uint32_t levels) {
+    struct stat st;
+    if (stat(log_file.c_str(), &st) != 0) {
+        throw std::runtime_error("Failed to open log file: " + log_file + ".");
+    }
+    std::uint64_t file_size = static_cast<std::uint64_t>(st.st_size);
+
+    std::vector<Entry> entries;
+    if (stat(indexFile(log_file).c_str(), &st) == 0)
+        entries = load(indexFile(log_file));
+
+    // 多个进程写入同一个日志文件时，索引项不一定按偏移的顺序追加
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+
+    // time_point::min()/max() 表示不限，system_clock 的精度低于纳秒时直接转换会溢出
+    auto nanoseconds = [](std::chrono::system_clock::time_point time) {
+        if (time == std::chrono::system_clock::time_point::min())
+            return std::numeric_limits<std::int64_t>::min();
+        if (time == std::chrono::system_clock::time_point::max())
+            return std::numeric_limits<std::int64_t>::max();
+        return static_cast<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+    };
+    std::int64_t from_ns = nanoseconds(from);
+    std::int64_t to_ns = nanoseconds(to);
+
+    std::vector<Range> ranges;
+    auto add = [&ranges](std::uint64_t offset, std::uint64_t end) {
+        if (!ranges.empty() && ranges.back().offset + ranges.back().size == offset)
+            ranges.back().size += end - offset;
+        else
+            ranges.push_back(Range{offset, end - offset});
+    };
+
+    // 相邻索引项之间没有被覆盖的部分都视为可能匹配
+    std::uint64_t pos = 0;
+    for (const Entry& entry : entries) {
+        std::uint64_t end = entry.offset + entry.size;
+        if (entry.offset < pos || end > file_size)
+            continue;
+        if (entry.offset > pos)
+            add(pos, entry.offset);
+        if ((entry.levels & levels) != 0 && entry.last_time_ns >= from_ns && entry.first_time_ns <= to_ns)
+            add(entry.offset, end);
+        pos = end;
+    }
+    if (pos < file_size)
+        add(pos, file_size);
+    return ranges;
+}
+
+#endif // MYLOGGER_FILEINDEX_INL_HPP
@@ -0,0 +1,123 @@
+// 日志文件的稀疏索引: 文件输出线程在写入日志文件的同时，增量维护同目录下的索引文件(日志文件名 + ".idx"),
+// 按时间范围与日志等级查询时只需读取可能匹配的部分(FileIndex::query() 或 tools/ 下的 logquery 工具)。
+//
+// 日志文件按写入顺序划分为块: 块的大小达到 block_size 或时间跨度达到 block_interval 时结束当前块，并向索引文件追加一项
+// Entry 作为检查点，记录块在日志文件中的偏移与长度、块内日志时间戳的范围以及出现过的日志等级(位图)。
+// 尚未结束的块只保存在内存中。日志文件中没有被索引覆盖的部分(末尾尚未结束的块、共享收集进程写入的日志、
+// 其他进程写入的日志)在查询时都视为可能匹配。日志文件被截断后，下一个块结束时重新建立索引文件。
+//
+// 索引文件的布局(本机字节序): Header + 若干个 Entry, 按块结束的顺序追加。
+
+#pragma once
+
+#ifndef MYLOGGER_FILEINDEX_HPP
+#define MYLOGGER_FILEINDEX_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "loglevel.hpp"
+
+// 文件索引的参数，通过 Logger::setFileIndex() 设置
+struct FileIndexOptions {
+    bool enabled = true;                            // 是否为输出到文件的日志建立索引
+    std::size_t block_size = 256 * 1024;            // 块的最大字节数
+    std::chrono::milliseconds block_interval{1000}; // 块的最大时间跨度
+};
+
+class FileIndex {
+  private:
+    // 友元类声明，仅允许 Logger 类、LogWriter 类与 ThreadsPool 类访问私有成员
+    friend class Logger;
+    friend class LogWriter;
+    friend class ThreadsPool;
+
+  public:
+    static constexpr std::uint32_t kVersion = 1;
+
+    // 索引文件头
+    struct Header {
+        char magic[8]; // "MYLOGIX1"
+        std::uint32_t version;
+        std::uint32_t entry_size; // sizeof(Entry)
+    };
+
+    // 索引项，描述日志文件中的一个块
+    struct Entry {
+        std::uint64_t offset;       // 块在日志文件中的偏移
+        std::uint64_t size;         // 块的字节数
+        std::int64_t first_time_ns; // 块内日志时间戳的最小值(system_clock, 纳秒)
+        std::int64_t last_time_ns;  // 块内日志时间戳的最大值
+        std::uint32_t levels;       // 块内出现过的日志等级，第 i 位对应 LogLevel(i)
+        std::uint32_t count;        // 块内的日志条数
+    };
+
+    // 日志文件中的一段区域
+    struct Range {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // 日志文件对应的索引文件名
+    static std::string indexFile(const std::string& log_file);
+
+    // 读取索引文件中的所有索引项。文件无法读取或格式不正确时抛出 std::runtime_error.
+    static std::vector<Entry> load(const std::string& index_file);
+
+    // 返回 log_file 中可能包含时间戳在 [from, to] 内、等级属于 levels(位图)的日志的区域，按偏移排序并合并相邻的区域。
+    // 区域的边界总是落在日志之间。没有索引文件时返回整个日志文件; 日志文件无法读取时抛出 std::runtime_error.
+    static std::vector<Range> query(const std::string& log_file, std::chrono::system_clock::time_point from,
+                                    std::chrono::system_clock::time_point to, std::uint32_t levels);
+
+  private:
+    // 尚未结束的块
+    struct Block {
+        Entry entry;
+        std::chrono::steady_clock::time_point opened; // 块的第一条日志的写入时间
+    };
+
+    // 由文件输出线程独占的状态
+    struct State {
+        FileIndexOptions options{false};
+        std::unordered_map<std::string, Block> blocks; // 每个日志文件当前尚未结束的块
+
+        // Logger::setFileIndex() 设置的新参数，由文件输出线程在下一次写入时应用
+        std::mutex mtx;
+        FileIndexOptions new_options{false};
+        std::atomic<bool> changed{false};
+
+        // 结束所有尚未结束的块
+        ~State();
+    };
+
+    static State& state();
+
+    // 设置索引的参数，可以在任意线程调用
+    static void setOptions(const FileIndexOptions& options);
+
+    // 应用新参数并返回是否启用了索引。仅由文件输出线程调用。
+    static bool enabled();
+
+    // 记录一条写入日志文件 log_file 的 offset 处、长度为 size 的日志。仅由文件输出线程在持有 m_file_mtx 时调用。
+    static void record(const std::string& log_file, std::uint64_t offset, std::uint64_t size, LogLevel level,
+                       std::chrono::system_clock::time_point time);
+
+    // 将块追加到索引文件中。日志文件比索引文件中已有的块短(被截断或替换)时先清空索引文件。
+    static void closeBlock(const std::string& log_file, const Entry& entry);
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_FILEINDEX_INL_HPP
+#include "fileindex-inl.hpp"
+MYLOGGER_FILEINDEX_INL_HPP
+#endif // MYLOGGER_FILEINDEX_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_FILEINDEX_HPP
@@ -0,0 +1,586 @@
+// flightrecorder 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_FLIGHTRECORDER_INL_HPP
+#define MYLOGGER_FLIGHTRECORDER_INL_HPP
+
+#ifndef MYLOGGER_FLIGHTRECORDER_HPP
+#include "flightrecorder.hpp"
+#endif // MYLOGGER_FLIGHTRECORDER_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "formatter.hpp"
+#include "threadspool.hpp"
+
+#ifdef __linux__
+struct FlightRecorder::CrashState {
+    static constexpr int kSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+    static constexpr std::size_t kSignalCount = sizeof(kSignals) / sizeof(kSignals[0]);
+    static constexpr std::size_t kStackSize = 64 * 1024; // 备用信号栈大小，SIGSTKSZ 在新版本 glibc 中不再是常量
+
+    char path[4096];                         // crash_file, 信号处理器中不能使用 std::string
+    const char* region;                      // 镜像地址
+    std::size_t region_size;                 // 镜像大小
+    struct sigaction previous[kSignalCount]; // 安装前的处理器，转储后恢复
+};
+#else
+struct FlightRecorder::CrashState {};
+#endif
+
+MYLOGGER_INLINE FlightRecorder::FlightRecorder(const FlightRecorderOptions& options)
+    : m_options(options), m_region(nullptr), m_region_size(0), m_dump_pending(false), m_last_dump(0) {
+    if (m_options.max_threads == 0 || m_options.ring_size < 1024) {
+        throw std::runtime_error("Invalid flight recorder options: ring_size must be at least 1024 bytes and "
+                                 "max_threads must be positive.");
+    }
+
+    // 数据区大小向上取整到缓存行，使每个 RingHeader 对齐
+    m_options.ring_size = (m_options.ring_size + alignof(RingHeader) - 1) / alignof(RingHeader) * alignof(RingHeader);
+    m_region_size = kHeaderSize + m_options.max_threads * (sizeof(RingHeader) + m_options.ring_size);
+    m_locks.reset(new std::mutex[m_options.max_threads]);
+
+    if (!m_options.shared_memory_name.empty()) {
+#ifdef __linux__
+        int fd = shm_open(m_options.shared_memory_name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open shared memory " + m_options.shared_memory_name + ": " +
+                                     std::strerror(errno) + ".");
+        }
+        if (ftruncate(fd, static_cast<off_t>(m_region_size)) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Failed to resize shared memory " + m_options.shared_memory_name + ": " +
+                                     std::strerror(error) + ".");
+        }
+        void* region = mmap(nullptr, m_region_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (region == MAP_FAILED) {
+            throw std::runtime_error("Failed to map shared memory " + m_options.shared_memory_name + ": " +
+                                     std::strerror(error) + ".");
+        }
+        m_region = static_cast<char*>(region);
+#else
+        throw std::runtime_error("Shared memory flight recorder is only supported on Linux.");
+#endif
+    } else {
+        m_region = static_cast<char*>(::operator new(m_region_size, std::align_val_t(alignof(RingHeader))));
+    }
+
+    // 同名共享内存中可能残留上一次运行的内容，此时应已被外部进程读取
+    std::memset(m_region, 0, m_region_size);
+    Header header{};
+    std::memcpy(header.magic, "MYLOGFR1", sizeof(header.magic));
+    header.version = kVersion;
+    header.ring_count = m_options.max_threads;
+    header.ring_size = m_options.ring_size;
+    std::memcpy(m_region, &header, sizeof(header));
+    for (unsigned int i = 0; i < m_options.max_threads; i++) {
+        new (ringHeader(i)) RingHeader();
+    }
+}
+
+MYLOGGER_INLINE std::atomic<FlightRecorder*>& FlightRecorder::instance() {
+    static std::atomic<FlightRecorder*> recorder(nullptr);
+    return recorder;
+}
+
+MYLOGGER_INLINE void FlightRecorder::enable(const FlightRecorderOptions& options) {
+    static std::mutex mtx;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (instance().load(std::memory_order_acquire)) {
+        throw std::runtime_error("Flight recorder has already been enabled.");
+    }
+
+    // 飞行记录器在进程退出前不会销毁: 其他线程可能在静态对象析构期间仍在记录日志，崩溃处理器也需要访问镜像
+    std::unique_ptr<FlightRecorder> recorder(new FlightRecorder(options));
+    // 写入线程在 fork() 时可能正持有某个环形缓冲区的锁，子进程中的转储会一直等待
+    for (unsigned int i = 0; i < recorder->m_options.max_threads; i++) {
+        ThreadsPool::addForkLock(recorder->m_locks[i]);
+    }
+    if (!options.crash_file.empty()) {
+        installCrashHandler(*recorder);
+    }
+    instance().store(recorder.release(), std::memory_order_release);
+}
+
+MYLOGGER_INLINE std::string& FlightRecorder::localPayload() {
+    static thread_local std::string payload;
+    return payload;
+}
+
+MYLOGGER_INLINE void FlightRecorder::append(LogLevel level, std::size_t arg_count, std::string& payload) {
+    int index = localRing();
+    if (index < 0)
+        return;
+
+    // 单条记录最多占环形缓冲区的四分之一，过长的记录被截断
+    std::size_t max_payload = m_options.ring_size / 4 - sizeof(RecordHeader);
+    if (payload.size() > max_payload) {
+        payload.resize(max_payload);
+    }
+
+    RecordHeader header{};
+    header.size = static_cast<std::uint32_t>(sizeof(RecordHeader) + payload.size());
+    header.level = static_cast<std::uint8_t>(level);
+    header.arg_count = static_cast<std::uint8_t>(std::min<std::size_t>(arg_count, 255));
+    header.time_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                    std::chrono::system_clock::now().time_since_epoch())
+                                                    .count());
+    header.thread_id = currentThreadId();
+
+    RingHeader* ring = ringHeader(index);
+    char* data = ringData(index);
+    std::size_t ring_size = m_options.ring_size;
+    {
+        std::unique_lock<std::mutex> lock(m_locks[index]);
+        std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+        std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+
+        // 丢弃最早的记录，直到剩余空间可以容纳新记录
+        while (head + header.size - tail > ring_size) {
+            RecordHeader oldest;
+            copyOut(data, ring_size, tail, &oldest, sizeof(oldest));
+            tail += oldest.size;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+
+        copyIn(data, ring_size, head, &header, sizeof(header));
+        copyIn(data, ring_size, head + sizeof(header), payload.data(), payload.size());
+        ring->head.store(head + header.size, std::memory_order_release);
+    }
+
+    // ERROR 触发一次转储。转储在文件输出线程中执行(与 ERROR 日志一样进入优先通道)，等待执行期间的 ERROR 不再重复提交。
+    // 持续出错时每次转储都要解码全部环形缓冲区并重写文件，因此两次转储之间至少间隔 dump_interval_ms.
+    if (level == LogLevel::ERROR && !m_options.dump_file.empty()) {
+        std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now().time_since_epoch())
+                               .count();
+        std::int64_t last = m_last_dump.load(std::memory_order_relaxed);
+        std::int64_t interval = static_cast<std::int64_t>(m_options.dump_interval_ms) * 1000000;
+        if ((last == 0 || now - last >= interval) && !m_dump_pending.exchange(true)) {
+            m_last_dump.store(now, std::memory_order_relaxed);
+            ThreadsPool& pool = ThreadsPool::getThreadsPool();
+            // 记在当前生产者名下: 高优先级的转储只等待本线程之前的普通任务，不阻塞其他线程的 ERROR
+            pool.addFileOutputTask(pool.laneOf(level), ThreadsPool::producerId(), [this]() {
+                m_dump_pending.store(false);
+                try {
+                    dump(m_options.dump_file);
+                } catch (const std::exception&) {
+                    // 转储失败不影响日志输出，镜像仍保留在内存中
+                }
+            });
+        }
+    }
+}
+
+MYLOGGER_INLINE FlightRecorder::RingHeader* FlightRecorder::ringHeader(unsigned int index) const {
+    return reinterpret_cast<RingHeader*>(m_region + kHeaderSize + index * (sizeof(RingHeader) + m_options.ring_size));
+}
+
+MYLOGGER_INLINE char* FlightRecorder::ringData(unsigned int index) const {
+    return reinterpret_cast<char*>(ringHeader(index)) + sizeof(RingHeader);
+}
+
+MYLOGGER_INLINE int FlightRecorder::localRing() {
+    // 线程退出时释放占用的环形缓冲区，其中的记录保留到被下一个线程覆盖
+    struct Local {
+        FlightRecorder* recorder = nullptr;
+        int index = -1;
+        char* crash_stack = nullptr; // 本线程的备用信号栈
+
+        ~Local() {
+            if (recorder && index >= 0)
+                recorder->ringHeader(index)->owned.store(0, std::memory_order_release);
+            releaseCrashStack(crash_stack);
+        }
+    };
+    static thread_local Local local;
+    if (local.recorder == this)
+        return local.index;
+
+    // 首次记录时占用一个空闲的环形缓冲区，没有空闲缓冲区的线程不记录
+    local.recorder = this;
+    if (!m_options.crash_file.empty())
+        installCrashStack(local.crash_stack);
+    for (unsigned int i = 0; i < m_options.max_threads; i++) {
+        std::uint32_t expected = 0;
+        if (ringHeader(i)->owned.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+            local.index = static_cast<int>(i);
+            break;
+        }
+    }
+    return local.index;
+}
+
+MYLOGGER_INLINE std::uint64_t FlightRecorder::currentThreadId() {
+    // 与 Formatter::getThreadId() 的输出保持一致
+    static thread_local const std::uint64_t thread_id = [] {
+        std::ostringstream oss;
+#ifdef _WIN32
+        oss << std::hex << std::this_thread::get_id().hash();
+#else
+        oss << std::this_thread::get_id();
+#endif
+        std::uint64_t id = 0;
+        std::istringstream iss(oss.str());
+#ifdef _WIN32
+        iss >> std::hex;
+#endif
+        iss >> id;
+        return id;
+    }();
+    return thread_id;
+}
+
+MYLOGGER_INLINE void FlightRecorder::copyIn(char* data, std::size_t ring_size, std::uint64_t pos, const void* src,
+                                            std::size_t size) {
+    std::size_t offset = static_cast<std::size_t>(pos % ring_size);
+    std::size_t first = std::min(size, ring_size - offset);
+    std::memcpy(data + offset, src, first);
+    std::memcpy(data, static_cast<const char*>(src) + first, size - first);
+}
+
+MYLOGGER_INLINE void FlightRecorder::copyOut(const char* data, std::size_t ring_size, std::uint64_t pos, void* dst,
+                                             std::size_t size) {
+    std::size_t offset = static_cast<std::size_t>(pos % ring_size);
+    std::size_t first = std::min(size, ring_size - offset);
+    std::memcpy(dst, data + offset, first);
+    std::memcpy(static_cast<char*>(dst) + first, data, size - first);
+}
+
+MYLOGGER_INLINE void FlightRecorder::dump(const std::string& file_name) {
+    std::ostringstream oss;
+    decodeImage(m_region, m_region_size, oss, m_locks.get());
+
+    // 先写入临时文件再重命名，读取方不会看到写了一半的转储
+    std::string temp_file = file_name + ".tmp";
+    {
+        std::ofstream file(temp_file, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open flight recorder dump file: " + temp_file + ".");
+        }
+        file << oss.str();
+        if (!file.flush()) {
+            throw std::runtime_error("Failed to write flight recorder dump file: " + temp_file + ".");
+        }
+    }
+    if (std::rename(temp_file.c_str(), file_name.c_str()) != 0) {
+        std::remove(temp_file.c_str());
+        throw std::runtime_error("Failed to rename flight recorder dump file to " + file_name + ".");
+    }
+}
+
+MYLOGGER_INLINE void FlightRecorder::decode(const std::string& image_file, std::ostream& out) {
+    std::ifstream file(image_file, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open flight recorder image: " + image_file + ".");
+    }
+    std::string image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    decodeImage(image.data(), image.size(), out, nullptr);
+}
+
+MYLOGGER_INLINE void FlightRecorder::decodeImage(const char* image, std::size_t size, std::ostream& out,
+                                                 std::mutex* locks) {
+    Header header;
+    if (size < kHeaderSize) {
+        throw std::runtime_error("Invalid flight recorder image: file is too small.");
+    }
+    std::memcpy(&header, image, sizeof(header));
+    if (std::memcmp(header.magic, "MYLOGFR1", sizeof(header.magic)) != 0 || header.version != kVersion) {
+        throw std::runtime_error("Invalid flight recorder image: bad magic or version.");
+    }
+    std::size_t ring_size = static_cast<std::size_t>(header.ring_size);
+    std::size_t stride = sizeof(RingHeader) + ring_size;
+    if (ring_size < sizeof(RecordHeader) || header.ring_count == 0 ||
+        (size - kHeaderSize) / stride < header.ring_count) {
+        throw std::runtime_error("Invalid flight recorder image: truncated ring buffers.");
+    }
+
+    struct Entry {
+        std::uint64_t time_ns;
+        std::string text;
+    };
+
+    // 解码后的参数
+    struct DecodedArg {
+        char type = 's';
+        std::int64_t i = 0;
+        std::uint64_t u = 0;
+        double d = 0;
+        bool b = false;
+        char c = '\0';
+        const void* p = nullptr;
+        std::string text;
+
+        FormatArg toFormatArg() const {
+            switch (type) {
+            case 'i':
+                return FormatArg::of(i);
+            case 'u':
+                return FormatArg::of(u);
+            case 'd':
+                return FormatArg::of(d);
+            case 'b':
+                return FormatArg::of(b);
+            case 'c':
+                return FormatArg::of(c);
+            case 'p':
+                return FormatArg::of(p);
+            default:
+                return FormatArg::of(text);
+            }
+        }
+    };
+    std::vector<Entry> entries;
+    std::string data;
+    std::vector<DecodedArg> args;
+
+    for (std::uint32_t i = 0; i < header.ring_count; i++) {
+        const char* ring = image + kHeaderSize + i * stride;
+        std::uint64_t head;
+        std::uint64_t tail;
+        {
+            // 在锁内拷贝整个数据区，解码时不阻塞写入线程
+            std::unique_lock<std::mutex> lock;
+            if (locks)
+                lock = std::unique_lock<std::mutex>(locks[i]);
+            std::memcpy(&head, ring + offsetof(RingHeader, head), sizeof(head));
+            std::memcpy(&tail, ring + offsetof(RingHeader, tail), sizeof(tail));
+            if (head == tail || head < tail || head - tail > ring_size)
+                continue;
+            data.assign(ring + sizeof(RingHeader), ring_size);
+        }
+
+        for (std::uint64_t pos = tail; pos < head;) {
+            RecordHeader record;
+            if (head - pos < sizeof(record))
+                break;
+            copyOut(data.data(), ring_size, pos, &record, sizeof(record));
+            // 崩溃时可能正在写入最后一条记录，遇到不完整或损坏的记录时停止解码该缓冲区
+            if (record.size < sizeof(record) || record.size > head - pos ||
+                record.level > static_cast<std::uint8_t>(LogLevel::ERROR))
+                break;
+
+            std::string payload(record.size - sizeof(record), '\0');
+            copyOut(data.data(), ring_size, pos + sizeof(record), &payload[0], payload.size());
+            pos += record.size;
+
+            // 拆分为格式化字符串与参数，截断的记录缺少的参数为空字符串
+            std::size_t pos_arg = payload.find('\0');
+            std::string message = payload.substr(0, pos_arg);
+            pos_arg = pos_arg == std::string::npos ? payload.size() : pos_arg + 1;
+            args.assign(record.arg_count, DecodedArg());
+            for (auto& arg : args) {
+                if (pos_arg >= payload.size())
+                    break;
+                char type = payload[pos_arg++];
+                if (type == 's') {
+                    std::size_t end = std::min(payload.find('\0', pos_arg), payload.size());
+                    arg.text = payload.substr(pos_arg, end - pos_arg);
+                    pos_arg = end + 1;
+                    continue;
+                }
+
+                std::size_t raw_size = type == 'b' || type == 'c' ? 1 : 8;
+                if (payload.size() - pos_arg < raw_size)
+                    break;
+                const char* raw = payload.data() + pos_arg;
+                pos_arg += raw_size;
+                arg.type = type;
+                switch (type) {
+                case 'i':
+                    std::memcpy(&arg.i, raw, sizeof(arg.i));
+                    break;
+                case 'u':
+                    std::memcpy(&arg.u, raw, sizeof(arg.u));
+                    break;
+                case 'd':
+                    std::memcpy(&arg.d, raw, sizeof(arg.d));
+                    break;
+                case 'b':
+                    arg.b = *raw != 0;
+                    break;
+                case 'c':
+                    arg.c = *raw;
+                    break;
+                case 'p': {
+                    std::uint64_t address;
+                    std::memcpy(&address, raw, sizeof(address));
+                    arg.p = reinterpret_cast<const void*>(static_cast<std::uintptr_t>(address));
+                    break;
+                }
+                default:
+                    // 未知的类型: 记录已损坏，剩余参数为空
+                    arg.type = 's';
+                    pos_arg = payload.size();
+                    break;
+                }
+            }
+
+            // 用记录中的时间与线程ID重新格式化
+            Formatter formatter(static_cast<LogLevel>(record.level));
+            formatter.m_time = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(record.time_ns)));
+            formatter.m_thread_id = std::to_string(record.thread_id);
+            formatter.m_context.reset();
+            formatter.m_location = nullptr;
+
+            std::string text;
+            try {
+                std::vector<FormatArg> format_args;
+                for (const auto& arg : args) {
+                    format_args.push_back(arg.toFormatArg());
+                }
+                formatter.parseTokens(message, format_args.data(), format_args.size());
+                text = formatter.formatedString();
+            } catch (const std::exception&) {
+                text = message;
+                for (const auto& arg : args) {
+                    text += ' ';
+                    FormatArg format_arg = arg.toFormatArg();
+                    format_arg.format(text, format_arg.value, FormatSpec());
+                }
+            }
+            text.erase(std::remove(text.begin(), text.end(), static_cast<char>(-128)), text.end());
+            if (text.empty() || text.back() != '\n')
+                text += '\n';
+
+            // 行首: 时间 等级 [线程ID]
+            static const char* const level_names[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+            auto time = std::chrono::system_clock::to_time_t(formatter.m_time);
+            struct tm buf;
+            localtime_r(&time, &buf);
+            std::ostringstream line;
+            line << std::put_time(&buf, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(6) << std::setfill('0')
+                 << record.time_ns / 1000 % 1000000 << ' ' << level_names[record.level] << " ["
+                 << record.thread_id << "] " << text;
+            entries.push_back({record.time_ns, line.str()});
+        }
+    }
+
+    // 合并所有线程的记录，按时间排序
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) { return a.time_ns < b.time_ns; });
+    for (const auto& entry : entries) {
+        out << entry.text;
+    }
+}
+
+MYLOGGER_INLINE FlightRecorder::CrashState& FlightRecorder::crashState() {
+    static CrashState state;
+    return state;
+}
+
+MYLOGGER_INLINE void FlightRecorder::installCrashHandler(const FlightRecorder& recorder) {
+#ifdef __linux__
+    CrashState& state = crashState();
+    if (recorder.m_options.crash_file.size() >= sizeof(state.path)) {
+        throw std::runtime_error("Flight recorder crash file path is too long.");
+    }
+    std::memcpy(state.path, recorder.m_options.crash_file.c_str(), recorder.m_options.crash_file.size() + 1);
+    state.region = recorder.m_region;
+    state.region_size = recorder.m_region_size;
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = &FlightRecorder::onCrash;
+    // 栈溢出引发的 SIGSEGV 无法在原来的栈上处理，处理器运行在记录线程的备用信号栈上(见 installCrashStack())
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (std::size_t i = 0; i < CrashState::kSignalCount; i++) {
+        sigaction(CrashState::kSignals[i], &action, &state.previous[i]);
+    }
+#else
+    (void)recorder;
+#endif
+}
+
+MYLOGGER_INLINE void FlightRecorder::installCrashStack(char*& stack) {
+#ifdef __linux__
+    stack_t current;
+    if (sigaltstack(nullptr, &current) != 0 || !(current.ss_flags & SS_DISABLE))
+        return;
+    stack_t alternate;
+    std::memset(&alternate, 0, sizeof(alternate));
+    alternate.ss_sp = new char[CrashState::kStackSize];
+    alternate.ss_size = CrashState::kStackSize;
+    if (sigaltstack(&alternate, nullptr) != 0) {
+        delete[] static_cast<char*>(alternate.ss_sp);
+        return;
+    }
+    stack = static_cast<char*>(alternate.ss_sp);
+#else
+    (void)stack;
+#endif
+}
+
+MYLOGGER_INLINE void FlightRecorder::releaseCrashStack(char*& stack) {
+#ifdef __linux__
+    if (!stack)
+        return;
+    // 只有当前的备用栈仍是自己安装的那个时才卸载，用户之后可能替换了备用栈
+    stack_t current;
+    if (sigaltstack(nullptr, &current) == 0 && current.ss_sp == stack) {
+        stack_t disable;
+        std::memset(&disable, 0, sizeof(disable));
+        disable.ss_flags = SS_DISABLE;
+        sigaltstack(&disable, nullptr);
+    }
+    delete[] stack;
+    stack = nullptr;
+#else
+    (void)stack;
+#endif
+}
+
+MYLOGGER_INLINE void FlightRecorder::onCrash(int signal_number) {
+#ifdef __linux__
+    CrashState& state = crashState();
+    int fd = open(state.path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        std::size_t written = 0;
+        while (written < state.region_size) {
+            ssize_t n = write(fd, state.region + written, state.region_size - written);
+            if (n <= 0)
+                break;
+            written += static_cast<std::size_t>(n);
+        }
+        close(fd);
+    }
+
+    // 恢复原来的处理器(通常是默认处理: 终止进程并生成 core dump)后重新发出信号
+    for (std::size_t i = 0; i < CrashState::kSignalCount; i++) {
+        if (CrashState::kSignals[i] == signal_number) {
+            sigaction(signal_number, &state.previous[i], nullptr);
+        }
+    }
+    raise(signal_number);
+#else
+    (void)signal_number;
+#endif
+}
+
+#endif // MYLOGGER_FLIGHTRECORDER_INL_HPP
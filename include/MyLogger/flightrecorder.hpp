@@ -0,0 +1,200 @@
+// 飞行记录器: 将每条日志(包括被日志等级过滤掉的 DEBUG 日志)以二进制形式写入每个线程独立的内存环形缓冲区,
+// 只在出现 ERROR、进程崩溃或通过 Logger::dumpFlightRecorder() 请求时才转储到磁盘。
+// 环形缓冲区可以位于共享内存(shm_open)中，进程被强制终止后外部进程仍然可以读取并恢复其中的日志。
+//
+// 二进制镜像(共享内存、崩溃转储文件)的布局:
+//     Header(占 kHeaderSize 字节)
+//     ring_count 个环形缓冲区，每个为 RingHeader + ring_size 字节的数据区
+// 数据区中的每条记录为 RecordHeader + 格式化字符串 + '\0' + arg_count 个参数，可能跨越数据区末尾回绕。
+// 每个参数以一个类型字节开头: 'i' int64, 'u' uint64, 'd' double, 'p' 指针(uint64), 'b' bool, 'c' char 之后为原始字节;
+// 's' 之后为以 '\0' 结尾的文本(字符串以及其他类型通过 ArgFormatter 转换的结果，延迟求值的参数记为 "<lazy>")。
+// [tail, head) 为有效记录所在的累计字节区间，在数据区中的偏移为位置对 ring_size 取模。
+// 可以通过 FlightRecorder::decode() 将镜像文件解码为文本。
+
+#pragma once
+
+#ifndef MYLOGGER_FLIGHTRECORDER_HPP
+#define MYLOGGER_FLIGHTRECORDER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "common.hpp"
+#include "argformatter.hpp"
+#include "loglevel.hpp"
+
+// 飞行记录器的参数，通过 Logger::enableFlightRecorder() 设置
+struct FlightRecorderOptions {
+    std::size_t ring_size = 64 * 1024;     // 每个线程的环形缓冲区大小(字节)
+    unsigned int max_threads = 64;         // 环形缓冲区个数，超出的线程不记录
+    std::string shared_memory_name;        // 非空时将环形缓冲区放在该名称的 POSIX 共享内存中，如 "/myapp-flight".
+                                           // 进程退出后共享内存仍然保留，由读取方 shm_unlink()
+    std::string dump_file = "flight.log";  // 出现 ERROR 时转储的文本文件，为空表示不转储
+    unsigned int dump_interval_ms = 1000;  // ERROR 触发的两次转储之间的最小间隔(毫秒)，间隔内的 ERROR 不再触发转储
+    std::string crash_file = "flight.bin"; // 收到 SIGSEGV 等崩溃信号时写入的二进制镜像，为空表示不安装信号处理器.
+                                           // 处理器运行在每个记录线程的备用信号栈上，栈溢出时也能转储
+};
+
+class FlightRecorder {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+
+  public:
+    static constexpr std::uint32_t kVersion = 1;
+    static constexpr std::size_t kHeaderSize = 64;
+
+    // 镜像文件头
+    struct Header {
+        char magic[8]; // "MYLOGFR1"
+        std::uint32_t version;
+        std::uint32_t ring_count;
+        std::uint64_t ring_size;
+    };
+
+    // 环形缓冲区头，独占一条缓存行
+    struct alignas(64) RingHeader {
+        std::atomic<std::uint64_t> head;  // 下一条记录的写入位置(累计字节数)
+        std::atomic<std::uint64_t> tail;  // 最早一条有效记录的位置
+        std::atomic<std::uint32_t> owned; // 是否被某个线程占用。线程退出后记录保留，直到被下一个线程覆盖。
+    };
+
+    // 记录头
+    struct RecordHeader {
+        std::uint32_t size;      // 整条记录的字节数(含记录头)
+        std::uint8_t level;      // LogLevel
+        std::uint8_t arg_count;  // 参数个数
+        std::uint16_t reserved;  // 保留
+        std::uint64_t time_ns;   // system_clock 时间戳(纳秒)
+        std::uint64_t thread_id; // 线程ID, 与 {thread} 的输出相同
+    };
+
+    // 将二进制镜像文件(崩溃转储文件或共享内存的拷贝)解码为文本。文件无法读取或格式不正确时抛出 std::runtime_error.
+    static void decode(const std::string& image_file, std::ostream& out);
+
+  private:
+    // 崩溃信号处理器使用的状态，在安装处理器之前准备好
+    struct CrashState;
+
+  private:
+    FlightRecorderOptions m_options;
+    char* m_region;                        // 镜像所在的内存(堆或共享内存)
+    std::size_t m_region_size;             // 镜像大小
+    std::unique_ptr<std::mutex[]> m_locks; // 每个环形缓冲区一个锁，只在写入线程与转储之间竞争
+    std::atomic<bool> m_dump_pending;      // 已有一次 ERROR 转储在等待执行
+    std::atomic<std::int64_t> m_last_dump; // 上一次 ERROR 触发转储的时间(steady_clock 纳秒)，0 表示尚未转储
+
+  private:
+    explicit FlightRecorder(const FlightRecorderOptions& options);
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    // 当前启用的飞行记录器，未启用时为 nullptr. 启用后不会销毁(见 enable())。
+    static std::atomic<FlightRecorder*>& instance();
+
+    // 启用飞行记录器，只能调用一次，否则抛出 std::runtime_error
+    static void enable(const FlightRecorderOptions& options);
+
+    // 记录一条日志。未启用时只有一次原子读取。
+    template <typename... Args>
+    static void record(LogLevel level, const std::string& message, const Args&... args);
+
+    // 按类型将参数编码到 payload 末尾
+    template <typename T>
+    static void encodeArg(std::string& payload, const T& value);
+
+    // 当前线程复用的编码缓冲区
+    static std::string& localPayload();
+
+    // 将编码好的记录(格式化字符串与参数)写入当前线程的环形缓冲区
+    void append(LogLevel level, std::size_t arg_count, std::string& payload);
+
+    RingHeader* ringHeader(unsigned int index) const;
+    char* ringData(unsigned int index) const;
+
+    // 当前线程占用的环形缓冲区下标，没有空闲缓冲区时返回 -1
+    int localRing();
+
+    // 当前线程的数字ID
+    static std::uint64_t currentThreadId();
+
+    // 在数据区的累计位置 pos 处写入/读取 size 字节，处理回绕
+    static void copyIn(char* data, std::size_t ring_size, std::uint64_t pos, const void* src, std::size_t size);
+    static void copyOut(const char* data, std::size_t ring_size, std::uint64_t pos, void* dst, std::size_t size);
+
+    // 将所有环形缓冲区解码为文本写入 file_name(先写入临时文件再重命名)
+    void dump(const std::string& file_name);
+
+    // 解码内存中的镜像。locks 非空时逐个加锁读取各个环形缓冲区。
+    static void decodeImage(const char* image, std::size_t size, std::ostream& out, std::mutex* locks);
+
+    // 崩溃信号处理器: 只调用异步信号安全的函数，将镜像原样写入 crash_file 后交给原来的处理器
+    static CrashState& crashState();
+    static void installCrashHandler(const FlightRecorder& recorder);
+
+    // 为当前线程安装/释放处理器使用的备用信号栈(sigaltstack)，线程已有备用栈时不替换
+    static void installCrashStack(char*& stack);
+    static void releaseCrashStack(char*& stack);
+    static void onCrash(int signal_number);
+};
+
+template <typename... Args>
+void FlightRecorder::record(LogLevel level, const std::string& message, const Args&... args) {
+    FlightRecorder* recorder = instance().load(std::memory_order_acquire);
+    if (!recorder)
+        return;
+
+    std::string& payload = localPayload();
+    payload.assign(message);
+    payload += '\0';
+    (encodeArg(payload, args), ...);
+    recorder->append(level, sizeof...(Args), payload);
+}
+
+template <typename T>
+void FlightRecorder::encodeArg(std::string& payload, const T& value) {
+    // 数值按原始字节保存，解码时仍可按占位符中的格式说明格式化
+    auto appendRaw = [&payload](char type, const auto& raw) {
+        payload += type;
+        payload.append(reinterpret_cast<const char*>(&raw), sizeof(raw));
+    };
+
+    if constexpr (std::is_same_v<T, bool>) {
+        appendRaw('b', value);
+    } else if constexpr (std::is_same_v<T, char>) {
+        appendRaw('c', value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        appendRaw('i', static_cast<std::int64_t>(value));
+    } else if constexpr (std::is_integral_v<T>) {
+        appendRaw('u', static_cast<std::uint64_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        appendRaw('d', static_cast<double>(value));
+    } else if constexpr (std::is_enum_v<T> && !HasOstreamOperator<T>::value) {
+        encodeArg(payload, static_cast<std::underlying_type_t<T>>(value));
+    } else if constexpr (IsDeferredArg<T>::value || !std::is_same_v<typename LazyArg<T>::Type, T>) {
+        // 延迟求值的参数不在这里求值，否则被过滤掉的日志也要付出求值的开销
+        payload += 's';
+        payload += "<lazy>";
+        payload += '\0';
+    } else if constexpr (std::is_pointer_v<T> && !std::is_same_v<std::decay_t<std::remove_pointer_t<T>>, char>) {
+        appendRaw('p', static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(value)));
+    } else {
+        payload += 's';
+        ArgFormatter<T>::format(payload, value, FormatSpec());
+        payload += '\0';
+    }
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_FLIGHTRECORDER_INL_HPP
+#include "flightrecorder-inl.hpp"
+MYLOGGER_FLIGHTRECORDER_INL_HPP
+#endif // MYLOGGER_FLIGHTRECORDER_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_FLIGHTRECORDER_HPP
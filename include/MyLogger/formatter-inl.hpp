@@ -9,6 +9,7 @@
 #include "formatter.hpp"
 #endif // MYLOGGER_FORMATTER_HPP
 
+#include <array>
 #include <bitset>
 #include <iomanip>
 #include <map>
@@ -17,12 +18,25 @@
 #include <thread>
 #include <tuple>
 
-inline Formatter::Formatter(LogLevel level) : m_level(level) {
+MYLOGGER_INLINE Formatter::Formatter(LogLevel level)
+    : m_level(level), m_producer(0), m_context(LogContext::current()), m_location(CallSite::current()) {
     getCurrentTime();
     getThreadId();
 }
 
-inline std::pair<Formatter::Token, std::string> Formatter::tokenize(const std::string& token_string) {
+MYLOGGER_INLINE Formatter::Formatter() : m_level(LogLevel::INFO), m_producer(0), m_location(nullptr) {
+}
+
+MYLOGGER_INLINE void Formatter::reset(LogLevel level) {
+    m_level = level;
+    m_format_tokens.clear();
+    m_context = LogContext::current();
+    m_location = CallSite::current();
+    getCurrentTime();
+    getThreadId();
+}
+
+MYLOGGER_INLINE std::pair<Formatter::Token, std::string> Formatter::tokenize(const std::string& token_string) {
     std::pair<Token, std::string> result;
 
     auto ptr = token_string.find(':', 1);
@@ -37,20 +51,7 @@ inline std::pair<Formatter::Token, std::string> Formatter::tokenize(const std::s
     // 解析 "{level}"
     if (token_name == "level") {
         result.first = Token::LEVEL;
-        switch (m_level) {
-        case LogLevel::DEBUG:
-            result.second = "DEBUG";
-            break;
-        case LogLevel::INFO:
-            result.second = "INFO";
-            break;
-        case LogLevel::WARNING:
-            result.second = "WARNING";
-            break;
-        case LogLevel::ERROR:
-            result.second = "ERROR";
-            break;
-        }
+        result.second = levelName(m_level);
     }
 
     // 解析 "{time:format}"
@@ -75,38 +76,31 @@ inline std::pair<Formatter::Token, std::string> Formatter::tokenize(const std::s
     // 解析 "{thread:format}"
     else if (token_name == "thread") {
         result.first = Token::THREAD;
+        result.second = threadString(has_arg ? token_string.substr(ptr + 1, token_string.size() - ptr - 2) : "");
+    }
+
+    // 解析 "{ctx:key}" 与 "{ctx}": 当前线程没有该字段时输出空字符串
+    else if (token_name == "ctx") {
+        result.first = Token::CONTEXT;
         if (has_arg) {
-            std::string thread_arg = token_string.substr(ptr + 1, token_string.size() - ptr - 2);
-            if (thread_arg == "B" || thread_arg == "b") {
-                // 将 m_thread_id 转换为二进制数字字符串
-                long long decimal = std::stoll(m_thread_id); // 将 m_thread_id 转为十进制整数
-                std::bitset<64> binary(decimal);             // 假设最多 64 位
-                result.second = binary.to_string();
-                size_t pos = result.second.find('1');
-                if (pos == std::string::npos) {
-                    result.second = "0b0";
-                }
-                result.second = std::string("0b") + result.second.substr(pos); // 去除前导零
-            } else if (thread_arg == "O" || thread_arg == "o") {
-                // 将 m_thread_id 转换为八进制数字字符串
-                long long decimal = std::stoll(m_thread_id);
-                std::ostringstream oss;
-                oss << "0o" << std::oct << decimal;
-                result.second = oss.str();
-            } else if (thread_arg == "D" || thread_arg == "d") {
-                // 将 m_thread_id 转换为十进制数字字符串
-                result.second = m_thread_id;
-            } else if (thread_arg == "X" || thread_arg == "x") {
-                // 将 m_thread_id 转换为十六进制数字字符串
-                long long decimal = std::stoll(m_thread_id);
-                std::ostringstream oss;
-                oss << "0x" << std::hex << std::uppercase << decimal; // 输出大写字母
-                result.second = oss.str();
+            std::string key = token_string.substr(ptr + 1, token_string.size() - ptr - 2);
+            appendContext(result.second, &key);
+        } else {
+            appendContext(result.second, nullptr);
+        }
+    }
+
+    // 解析 "{file}"、"{line}"、"{func}": 源码位置只保存了指针，在这里才转换为字符串。位置未知时为空。
+    else if (token_name == "file" || token_name == "line" || token_name == "func") {
+        result.first = Token::SOURCE;
+        if (m_location && m_location->file) {
+            if (token_name == "file") {
+                result.second = m_location->file;
+            } else if (token_name == "line") {
+                result.second = std::to_string(m_location->line);
             } else {
-                throw std::runtime_error("Invalid format argument for thread token: " + thread_arg + ".");
+                result.second = m_location->function;
             }
-        } else {
-            result.second = m_thread_id;
         }
     }
 
@@ -118,7 +112,71 @@ inline std::pair<Formatter::Token, std::string> Formatter::tokenize(const std::s
     return result;
 }
 
-inline std::string Formatter::formatedString() const {
+MYLOGGER_INLINE const char* Formatter::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::DEBUG:
+        return "DEBUG";
+    case LogLevel::INFO:
+        return "INFO";
+    case LogLevel::WARNING:
+        return "WARNING";
+    case LogLevel::ERROR:
+        return "ERROR";
+    }
+    return "";
+}
+
+MYLOGGER_INLINE std::string Formatter::threadString(const std::string& base) const {
+    if (base.empty() || base == "D" || base == "d") {
+        // 十进制: 直接使用 m_thread_id
+        return m_thread_id;
+    } else if (base == "B" || base == "b") {
+        // 将 m_thread_id 转换为二进制数字字符串
+        long long decimal = std::stoll(m_thread_id); // 将 m_thread_id 转为十进制整数
+        std::bitset<64> binary(decimal);             // 假设最多 64 位
+        std::string result = binary.to_string();
+        size_t pos = result.find('1');
+        if (pos == std::string::npos) {
+            return "0b0";
+        }
+        return std::string("0b") + result.substr(pos); // 去除前导零
+    } else if (base == "O" || base == "o") {
+        // 将 m_thread_id 转换为八进制数字字符串
+        long long decimal = std::stoll(m_thread_id);
+        std::ostringstream oss;
+        oss << "0o" << std::oct << decimal;
+        return oss.str();
+    } else if (base == "X" || base == "x") {
+        // 将 m_thread_id 转换为十六进制数字字符串
+        long long decimal = std::stoll(m_thread_id);
+        std::ostringstream oss;
+        oss << "0x" << std::hex << std::uppercase << decimal; // 输出大写字母
+        return oss.str();
+    }
+    throw std::runtime_error("Invalid format argument for thread token: " + base + ".");
+}
+
+MYLOGGER_INLINE void Formatter::appendContext(std::string& out, const std::string* key) const {
+    if (!m_context)
+        return;
+    if (key) {
+        const std::string* value = LogContext::find(*m_context, *key);
+        if (value)
+            out += *value;
+        return;
+    }
+    bool first = true;
+    for (const auto& field : *m_context) {
+        if (!first)
+            out += ' ';
+        first = false;
+        out += field.first;
+        out += '=';
+        out += field.second;
+    }
+}
+
+MYLOGGER_INLINE std::string Formatter::formatedString() const {
     std::string result;
     for (const auto& token : m_format_tokens) {
         result += token.second;
@@ -126,36 +184,35 @@ inline std::string Formatter::formatedString() const {
     return result;
 }
 
-inline void Formatter::getCurrentTime() {
+MYLOGGER_INLINE std::string Formatter::contentString() const {
+    std::string result;
+    for (const auto& token : m_format_tokens) {
+        if (token.first != Token::TIME)
+            result += token.second;
+    }
+    return result;
+}
+
+MYLOGGER_INLINE void Formatter::getCurrentTime() {
     m_time = std::chrono::system_clock::now();
 }
 
-inline void Formatter::getThreadId() {
-    std::ostringstream oss;
+MYLOGGER_INLINE void Formatter::getThreadId() {
+    // 线程ID在线程的生命周期内不变，每个线程只转换一次字符串
+    static thread_local const std::string thread_id = [] {
+        std::ostringstream oss;
 #ifdef _WIN32
-    oss << std::hex << std::this_thread::get_id().hash(); // Windows需特殊处理
+        oss << std::hex << std::this_thread::get_id().hash(); // Windows需特殊处理
 #else
-    oss << std::this_thread::get_id();
+        oss << std::this_thread::get_id();
 #endif
-    m_thread_id = oss.str();
+        return oss.str();
+    }();
+    m_thread_id = thread_id; // 复用的 Formatter 可以直接使用已有的容量
 }
 
-template <typename Type, typename... Args>
-void Formatter::expandArgs(std::vector<std::string>& args_vec, Type&& arg, Args&&... more_args) {
-
-    // 将参数转换为字符串，并存入 args_vec 中
-    std::ostringstream oss;
-    oss << arg;
-    args_vec.push_back(oss.str());
-
-    // 递归展开参数模板
-    if constexpr (sizeof...(more_args) > 0) {
-        expandArgs(args_vec, std::forward<Args>(more_args)...);
-    }
-}
-
-template <typename... Args>
-void Formatter::parseFormatString(const std::string& format_string_input, Args&&... args) {
+MYLOGGER_INLINE void Formatter::parseTokens(const std::string& format_string_input, const FormatArg* args,
+                                            std::size_t args_count) {
     m_format_tokens.clear();
     m_format_tokens.reserve(10); // 预留空间，避免多次扩容
 
@@ -190,14 +247,10 @@ void Formatter::parseFormatString(const std::string& format_string_input, Args&&
         }
     }
 
-    std::vector<std::string> args_vec; // 用于存放展开的参数包
-    args_vec.reserve(sizeof...(args));
-    if constexpr (sizeof...(args) > 0) {
-        expandArgs(args_vec, std::forward<Args>(args)...);
-    }
-
-    std::vector<unsigned int> empty_brackets_groups;                   // 空括号组在 m_format_tokens 中的位置
-    std::map<unsigned int, std::vector<unsigned int>> brackets_groups; // 括号组({0}、{1}...)在 m_format_tokens 中的位置
+    // 空括号组({}、{:x}...)在 m_format_tokens 中的位置及其格式说明
+    std::vector<std::pair<unsigned int, FormatSpec>> empty_brackets_groups;
+    // 括号组({0}、{1:x}...)在 m_format_tokens 中的位置及其格式说明
+    std::map<unsigned int, std::vector<std::pair<unsigned int, FormatSpec>>> brackets_groups;
 
     // 判断 brackets 是否为空，即字符串中是否有 {}
     if (brackets.empty()) {
@@ -238,9 +291,11 @@ void Formatter::parseFormatString(const std::string& format_string_input, Args&&
 
                 std::string token_string = format_string.substr(brackets[i], brackets[i + 1] - brackets[i] + 1);
 
-                // 检查括号组里的字符串是不是纯数字，如 {0}、{1}...
+                // 检查括号组里 ':' 之前的字符串是不是纯数字(或为空)，如 {0}、{1:x}、{:>8}...
+                auto colon = token_string.find(':');
+                std::size_t name_end = colon == std::string::npos ? token_string.size() - 1 : colon;
                 bool is_number = true;
-                for (unsigned int j = 1; j < token_string.size() - 1; j++) {
+                for (unsigned int j = 1; j < name_end; j++) {
                     if (!isdigit(token_string[j])) {
                         is_number = false;
                         break;
@@ -248,20 +303,19 @@ void Formatter::parseFormatString(const std::string& format_string_input, Args&&
                 }
 
                 if (is_number) {
-                    // 解析数字格式化字符串
+                    // 解析参数格式化字符串
+                    FormatSpec spec;
+                    if (colon != std::string::npos) {
+                        spec = FormatSpec::parse(token_string.substr(colon + 1, token_string.size() - colon - 2));
+                    }
                     m_format_tokens.emplace_back(Token::ARG, ""); // 先传入一个空字符串占位
 
-                    unsigned int num = std::stoi(token_string.substr(1, token_string.size() - 2));
-
-                    auto index = brackets_groups.find(num);
-                    if (index != brackets_groups.end()) {
-                        // 找到重复索引: 直接添加
-                        brackets_groups[num].push_back(m_format_tokens.size() - 1);
+                    if (name_end == 1) {
+                        // 没有索引，如 {:x}: 与空括号组相同
+                        empty_brackets_groups.emplace_back(m_format_tokens.size() - 1, spec);
                     } else {
-                        // 未找到重复索引，插入新索引
-                        std::vector<unsigned int> vector_temp;
-                        vector_temp.push_back(m_format_tokens.size() - 1);
-                        brackets_groups.insert(std::make_pair(num, std::move(vector_temp)));
+                        unsigned int num = std::stoi(token_string.substr(1, name_end - 1));
+                        brackets_groups[num].emplace_back(m_format_tokens.size() - 1, spec);
                     }
                 } else {
                     // 通过 tokenize() 解析单个格式化字符串，返回 Token 和内容
@@ -272,13 +326,7 @@ void Formatter::parseFormatString(const std::string& format_string_input, Args&&
                 // 空格式化字符串：直接匹配参数
 
                 m_format_tokens.emplace_back(Token::ARG, "");
-                empty_brackets_groups.push_back(m_format_tokens.size() - 1);
-
-                // if (args_count > sizeof...(args)) {
-                //     throw std::runtime_error("Invalid format string: too many arguments provided.");
-                // } else {
-                //     m_format_tokens.emplace_back(Token::ARG, args_vec[args_count++]);
-                // }
+                empty_brackets_groups.emplace_back(m_format_tokens.size() - 1, FormatSpec());
             }
             in_brackets = false;
             continue;
@@ -295,28 +343,30 @@ void Formatter::parseFormatString(const std::string& format_string_input, Args&&
     // 注意，map 容器会自动将键值对按照 key 的升序排列，因此不需要再次排序
     // 处理数字括号组
     for (const auto& [key, value] : brackets_groups) {
-        if (args_index >= sizeof...(args)) {
+        if (args_index >= args_count) {
             throw std::runtime_error("Invalid format string: too few arguments provided.");
         }
 
         std::ignore = key;
-        for (auto index : value) {
-            m_format_tokens[index].second = args_vec[args_index];
+        for (const auto& [index, spec] : value) {
+            args[args_index].format(m_format_tokens[index].second, args[args_index].value, spec);
         }
         args_index++;
     }
     // 处理空括号组
-    for (const auto& index : empty_brackets_groups) {
-        if (args_index >= sizeof...(args)) {
+    for (const auto& [index, spec] : empty_brackets_groups) {
+        if (args_index >= args_count) {
             throw std::runtime_error("Invalid format string: too few arguments provided.");
         }
 
-        m_format_tokens[index].second = args_vec[args_index++];
+        args[args_index].format(m_format_tokens[index].second, args[args_index].value, spec);
+        args_index++;
     }
 
-    // 将剩余的格式化字符串直接添加到末尾
-    for (unsigned int i = args_index; i < sizeof...(args); i++) {
-        m_format_tokens.emplace_back(Token::ARG, args_vec[i]);
+    // 将剩余的参数直接添加到末尾
+    for (std::size_t i = args_index; i < args_count; i++) {
+        m_format_tokens.emplace_back(Token::ARG, "");
+        args[i].format(m_format_tokens.back().second, args[i].value, FormatSpec());
     }
 }
 
@@ -5,26 +5,44 @@
 #ifndef MYLOGGER_FORMATTER_HPP
 #define MYLOGGER_FORMATTER_HPP
 
+#include <array>
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "common.hpp"
+#include "argformatter.hpp"
+#include "callsite.hpp"
+#include "logcontext.hpp"
 #include "loglevel.hpp"
 
 class Formatter {
   private:
     // 友元类声明，仅允许 Logger 类访问私有成员
     friend class Logger;
+    friend class FormatterPool;
+    friend class FlightRecorder;
+    friend class Layout;
+    friend class FormatterBench; // 性能测试(bench/main.cpp)直接测量格式化开销
 
   private:
     // 解析结果的 Token 类型
-    enum class Token { LEVEL, TIME, THREAD, TEXT, ARG };
+    enum class Token { LEVEL, TIME, THREAD, CONTEXT, SOURCE, TEXT, ARG };
 
   private:
     LogLevel m_level;                             // 日志等级
     std::chrono::system_clock::time_point m_time; // 时间戳
     std::string m_thread_id;                      // 线程ID
+    std::uint64_t m_producer;                     // 生产者编号(ThreadsPool::producerId()), 由 Logger 设置
+
+    // 记录日志时线程的诊断上下文快照，仅复制引用计数指针
+    std::shared_ptr<const LogContext::Fields> m_context;
+
+    // 调用点的源码位置(静态数据)，未通过 CallSite 记录日志时为 nullptr
+    const SourceLocation* m_location;
 
     // 格式化字符串解析结果
     std::vector<std::pair<Token, std::string>> m_format_tokens;
@@ -33,6 +51,12 @@ class Formatter {
     // 构造函数设为私有，禁止用户直接构造对象
     explicit Formatter(LogLevel level);
 
+    // 供 FormatterPool 预先构造对象，使用前需调用 reset()
+    Formatter();
+
+    // 重置为新的日志: 重新获取时间、线程ID、上下文与源码位置, 清空 m_format_tokens 但保留其容量
+    void reset(LogLevel level);
+
   private:
     // 解析单个格式化字符串，返回 Token 和内容。仅由 tokenize() 调用。
     std::pair<Token, std::string> tokenize(const std::string& token_string);
@@ -40,23 +64,43 @@ class Formatter {
     // 将 m_format_tokens 转换为格式化后的字符串，用于输出结果
     std::string formatedString() const;
 
-    // 展开参数模板，将参数转换为字符串，并存入 args_vec 中
-    // 仅由 parseFormatString() 调用
-    template <typename Type, typename... Args>
-    void expandArgs(std::vector<std::string>& result, Type&& arg, Args&&... more_args);
+    // 与 formatedString() 类似，但不包含时间戳，用于判断两条日志内容是否相同
+    std::string contentString() const;
 
     // 解析格式化字符串，将结果储存至 m_format_tokens 中
     template <typename... Args>
     void parseFormatString(const std::string& format_string, Args&&... args);
 
+    // parseFormatString() 的具体实现，参数已被类型擦除，因此不随参数类型实例化
+    void parseTokens(const std::string& format_string, const FormatArg* args, std::size_t args_count);
+
+  private:
+    // 供 tokenize() 与 Layout 共用的字段转换
+    static const char* levelName(LogLevel level);
+
+    // 按进制(B/O/D/X, 为空时原样输出)转换线程ID, 进制不合法时抛出 std::runtime_error
+    std::string threadString(const std::string& base) const;
+
+    // 将诊断上下文中 key 对应的值追加到 out 中，key 为空指针时追加全部键值对 "key1=value1 key2=value2"
+    void appendContext(std::string& out, const std::string* key) const;
+
   private:
     void getCurrentTime(); // 获取当前时间，并存入 m_time 中
     void getThreadId();    // 获取当前线程ID，并存入 m_thread_id 中
 };
 
+template <typename... Args>
+void Formatter::parseFormatString(const std::string& format_string, Args&&... args) {
+    // 在编译期为每个参数选择对应的 ArgFormatter
+    const std::array<FormatArg, sizeof...(Args)> format_args{{FormatArg::of(args)...}};
+    parseTokens(format_string, format_args.data(), format_args.size());
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
 #ifndef MYLOGGER_FORMATTER_INL_HPP
 #include "formatter-inl.hpp"
 MYLOGGER_FORMATTER_INL_HPP
 #endif // MYLOGGER_FORMATTER_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
 
 #endif // MYLOGGER_FORMATTER_HPP
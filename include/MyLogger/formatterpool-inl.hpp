@@ -0,0 +1,75 @@
+// formatterpool 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_FORMATTERPOOL_INL_HPP
+#define MYLOGGER_FORMATTERPOOL_INL_HPP
+
+#ifndef MYLOGGER_FORMATTERPOOL_HPP
+#include "formatterpool.hpp"
+#endif // MYLOGGER_FORMATTERPOOL_HPP
+
+#include <functional>
+#include <new>
+
+MYLOGGER_INLINE FormatterPool::FormatterPool() : m_slots(new Slot[kCapacity]), m_head(0) {
+    for (std::uint32_t i = 0; i < kCapacity; i++) {
+        m_slots[i].next.store(i + 1 < kCapacity ? i + 1 : kNil, std::memory_order_relaxed);
+    }
+}
+
+MYLOGGER_INLINE FormatterPool& FormatterPool::getFormatterPool() {
+    static FormatterPool instance;
+    return instance;
+}
+
+MYLOGGER_INLINE Formatter* FormatterPool::acquire(LogLevel level) {
+    std::uint64_t head = m_head.load(std::memory_order_acquire);
+    while (true) {
+        std::uint32_t index = static_cast<std::uint32_t>(head & kIndexMask);
+        if (index == kNil) {
+            // 池已耗尽(格式化线程积压)，退化为堆分配
+            Formatter* formatter(new Formatter(level));
+            if (!formatter) {
+                throw std::bad_alloc();
+            }
+            return formatter;
+        }
+
+        std::uint32_t next = m_slots[index].next.load(std::memory_order_relaxed);
+        std::uint64_t new_head = (((head >> 32) + 1) << 32) | next;
+        if (m_head.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
+            Formatter* formatter = &m_slots[index].formatter;
+            formatter->reset(level);
+            return formatter;
+        }
+    }
+}
+
+MYLOGGER_INLINE void FormatterPool::release(Formatter* formatter) {
+    Slot* slot = reinterpret_cast<Slot*>(formatter); // formatter 是 Slot 的第一个成员
+    std::less<const Slot*> less;
+    if (less(slot, m_slots.get()) || !less(slot, m_slots.get() + kCapacity)) {
+        delete formatter;
+        return;
+    }
+
+    std::uint32_t index = static_cast<std::uint32_t>(slot - m_slots.get());
+    std::uint64_t head = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        slot->next.store(static_cast<std::uint32_t>(head & kIndexMask), std::memory_order_relaxed);
+        std::uint64_t new_head = (((head >> 32) + 1) << 32) | index;
+        if (m_head.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
+}
+
+MYLOGGER_INLINE void FormatterPool::reclaimAll() {
+    for (std::uint32_t i = 0; i < kCapacity; i++) {
+        m_slots[i].next.store(i + 1 < kCapacity ? i + 1 : kNil, std::memory_order_relaxed);
+    }
+    std::uint64_t head = m_head.load(std::memory_order_relaxed);
+    m_head.store((((head >> 32) + 1) << 32) | 0, std::memory_order_release);
+}
+
+#endif // MYLOGGER_FORMATTERPOOL_INL_HPP
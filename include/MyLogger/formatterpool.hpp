@@ -0,0 +1,66 @@
+// Formatter 对象池。Formatter 由日志调用线程取出，由格式化线程归还，
+// 通过无锁的空闲链表复用对象，避免跨线程的 new/delete 以及 m_format_tokens 的反复扩容。
+
+#pragma once
+
+#ifndef MYLOGGER_FORMATTERPOOL_HPP
+#define MYLOGGER_FORMATTERPOOL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "common.hpp"
+#include "formatter.hpp"
+#include "loglevel.hpp"
+
+class FormatterPool {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+    friend class ThreadsPool;
+
+  private:
+    static constexpr std::uint32_t kCapacity = 1024;        // 池中预分配的 Formatter 数量
+    static constexpr std::uint32_t kNil = 0xFFFFFFFF;       // 空闲链表的结束标记
+    static constexpr std::uint64_t kIndexMask = 0xFFFFFFFF; // m_head 低 32 位为槽位下标
+
+    struct Slot {
+        Formatter formatter;
+        std::atomic<std::uint32_t> next; // 空闲链表中下一个槽位的下标
+    };
+
+  private:
+    std::unique_ptr<Slot[]> m_slots;
+
+    // 空闲链表头: 高 32 位为版本号，低 32 位为槽位下标。每次修改都递增版本号以避免 ABA 问题。
+    std::atomic<std::uint64_t> m_head;
+
+  private:
+    FormatterPool();
+    ~FormatterPool() = default;
+    FormatterPool(const FormatterPool&) = delete;
+    FormatterPool& operator=(const FormatterPool&) = delete;
+
+    static FormatterPool& getFormatterPool();
+
+  private:
+    // 取出一个 Formatter 并以 level 重置。池为空时退化为 new.
+    Formatter* acquire(LogLevel level);
+
+    // 归还 Formatter. 不属于池的对象(由 acquire() 退化分配的)直接 delete.
+    void release(Formatter* formatter);
+
+    // 将所有槽位放回空闲链表。只在 fork() 后的子进程中调用，此时父进程中的持有者(格式化任务、其他线程)都已不存在。
+    // 退化分配的对象无法找回，随被丢弃的任务泄漏，只在格式化线程积压超过 kCapacity 时出现。
+    void reclaimAll();
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_FORMATTERPOOL_INL_HPP
+#include "formatterpool-inl.hpp"
+MYLOGGER_FORMATTERPOOL_INL_HPP
+#endif // MYLOGGER_FORMATTERPOOL_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_FORMATTERPOOL_HPP
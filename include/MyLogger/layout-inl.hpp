@@ -0,0 +1,203 @@
+// layout 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_LAYOUT_INL_HPP
+#define MYLOGGER_LAYOUT_INL_HPP
+
+#ifndef MYLOGGER_LAYOUT_HPP
+#include "layout.hpp"
+#endif // MYLOGGER_LAYOUT_HPP
+
+#include <stdexcept>
+
+MYLOGGER_INLINE Layout::Layout(const std::string& pattern) {
+    std::string text;
+    bool has_message = false;
+    for (std::size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        if (c == '%' && i + 1 < pattern.size() && (pattern[i + 1] == '{' || pattern[i + 1] == '}')) {
+            // 转义的 %{ 与 %}
+            text += pattern[++i];
+        } else if (c == '{') {
+            std::size_t end = pattern.find('}', i + 1);
+            std::size_t next = pattern.find('{', i + 1);
+            if (end == std::string::npos || (next != std::string::npos && next < end)) {
+                throw std::runtime_error("Invalid layout pattern: missing closing '}' character.");
+            }
+            std::string token = pattern.substr(i + 1, end - i - 1);
+            has_message = has_message || token == "msg";
+            addText(text);
+            text.clear();
+            addToken(token);
+            i = end;
+        } else if (c == '}') {
+            throw std::runtime_error("Invalid layout pattern: missing opening '{' character.");
+        } else {
+            text += c;
+        }
+    }
+    addText(text);
+
+    if (!has_message) {
+        throw std::runtime_error("Invalid layout pattern: missing {msg}.");
+    }
+}
+
+MYLOGGER_INLINE void Layout::addText(const std::string& text) {
+    if (text.empty())
+        return;
+    if (!m_steps.empty() && m_steps.back().op == Op::TEXT) {
+        m_steps.back().arg += text;
+        return;
+    }
+    Step step;
+    step.op = Op::TEXT;
+    step.arg = text;
+    m_steps.push_back(step);
+}
+
+MYLOGGER_INLINE void Layout::addToken(const std::string& token) {
+    auto colon = token.find(':');
+    std::string name = token.substr(0, colon);
+    Step step;
+    step.has_arg = colon != std::string::npos;
+    if (step.has_arg)
+        step.arg = token.substr(colon + 1);
+
+    if (name == "msg" && !step.has_arg) {
+        step.op = Op::MESSAGE;
+    } else if (name == "level" && !step.has_arg) {
+        step.op = Op::LEVEL;
+    } else if (name == "time") {
+        // 将 %ms、%us、%ns 拆分为单独的操作，其余部分交给 strftime
+        std::string format = step.has_arg ? step.arg : "%Y-%m-%d %H:%M:%S";
+        std::string part;
+        auto flush = [this, &part] {
+            if (part.empty())
+                return;
+            Step time;
+            time.op = Op::TIME;
+            time.arg = part;
+            m_steps.push_back(time);
+            part.clear();
+        };
+        for (std::size_t i = 0; i < format.size(); i++) {
+            if (format[i] == '%' && i + 2 < format.size() && format[i + 2] == 's' &&
+                (format[i + 1] == 'm' || format[i + 1] == 'u' || format[i + 1] == 'n')) {
+                flush();
+                Step subsecond;
+                subsecond.op = Op::SUBSECOND;
+                subsecond.digits = format[i + 1] == 'm' ? 3 : format[i + 1] == 'u' ? 6 : 9;
+                m_steps.push_back(subsecond);
+                i += 2;
+            } else if (format[i] == '%' && i + 1 < format.size()) {
+                // 其他转换说明(包括 %%)原样保留
+                part += format[i];
+                part += format[++i];
+            } else {
+                part += format[i];
+            }
+        }
+        flush();
+        return;
+    } else if (name == "thread") {
+        const std::string& base = step.arg;
+        if (step.has_arg && base != "B" && base != "b" && base != "O" && base != "o" && base != "D" && base != "d" &&
+            base != "X" && base != "x") {
+            throw std::runtime_error("Invalid format argument for thread token: " + base + ".");
+        }
+        step.op = Op::THREAD;
+    } else if (name == "ctx") {
+        step.op = Op::CONTEXT;
+    } else if (name == "file" && !step.has_arg) {
+        step.op = Op::FILE;
+    } else if (name == "line" && !step.has_arg) {
+        step.op = Op::LINE;
+    } else if (name == "func" && !step.has_arg) {
+        step.op = Op::FUNC;
+    } else {
+        throw std::runtime_error("Invalid layout token: {" + token + "}.");
+    }
+    m_steps.push_back(step);
+}
+
+MYLOGGER_INLINE void Layout::render(std::string& out, const std::string& message, LogLevel level,
+                                    std::chrono::system_clock::time_point time, const Formatter* record) const {
+    // 消息末尾的换行符移到渲染结果的末尾
+    std::size_t length = message.size();
+    bool newline = length > 0 && message[length - 1] == '\n';
+    if (newline)
+        length--;
+
+    const SourceLocation* location = record && record->m_location && record->m_location->file ? record->m_location
+                                                                                                : nullptr;
+    for (const Step& step : m_steps) {
+        switch (step.op) {
+        case Op::TEXT:
+            out += step.arg;
+            break;
+        case Op::MESSAGE:
+            out.append(message, 0, length);
+            break;
+        case Op::LEVEL:
+            out += Formatter::levelName(level);
+            break;
+        case Op::TIME: {
+            // 向下取整到秒: to_time_t() 向零取整，1970 年之前的时间会多出一秒，与 SUBSECOND 不一致
+            std::time_t second = std::chrono::system_clock::to_time_t(std::chrono::floor<std::chrono::seconds>(time));
+            if (second != step.cached_second) {
+                struct tm buf;
+                localtime_r(&second, &buf);
+                char text[256];
+                step.cached.assign(text, std::strftime(text, sizeof(text), step.arg.c_str(), &buf));
+                step.cached_second = second;
+            }
+            out += step.cached;
+            break;
+        }
+        case Op::SUBSECOND: {
+            auto fraction = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch() %
+                                                                                 std::chrono::seconds(1));
+            // 1970 年之前的时间戳取模结果为负，归一化到 [0, 1s)，与 TIME 向下取整的秒一致
+            long long value = fraction.count();
+            if (value < 0)
+                value += 1000000000;
+            for (int i = step.digits; i < 9; i++)
+                value /= 10;
+            char digits[9];
+            for (int i = step.digits - 1; i >= 0; i--) {
+                digits[i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            out.append(digits, static_cast<std::size_t>(step.digits));
+            break;
+        }
+        case Op::THREAD:
+            if (record)
+                out += record->threadString(step.arg);
+            break;
+        case Op::CONTEXT:
+            if (record)
+                record->appendContext(out, step.has_arg ? &step.arg : nullptr);
+            break;
+        case Op::FILE:
+            if (location)
+                out += location->file;
+            break;
+        case Op::LINE:
+            if (location)
+                out += std::to_string(location->line);
+            break;
+        case Op::FUNC:
+            if (location)
+                out += location->function;
+            break;
+        }
+    }
+
+    if (newline)
+        out += '\n';
+}
+
+#endif // MYLOGGER_LAYOUT_INL_HPP
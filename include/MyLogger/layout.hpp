@@ -0,0 +1,77 @@
+// 输出布局(layout): 为控制台或文件设置的模式字符串，例如 "[{time:%H:%M:%S.%us}] [{level}] [{thread}] {msg}".
+// 模式字符串在设置时编译为一组格式化操作，之后每条日志只需依次执行这些操作，将格式化后的用户消息包装为输出的文本,
+// 日志调用中的格式化字符串只需包含消息本身。控制台与文件可以使用不同的布局，用户消息仍只格式化一次。
+//
+// 支持的占位符:
+//     {msg}                 用户消息，必须出现。消息末尾的换行符移到渲染结果的末尾
+//     {level}               日志等级
+//     {time[:format]}       时间戳，format 为 strftime 格式，默认为 "%Y-%m-%d %H:%M:%S". 额外支持 %ms、%us、%ns,
+//                           即秒以下的毫秒、微秒、纳秒部分(3、6、9 位)，优先于 strftime 的 %m、%u、%n
+//     {thread[:B|O|D|X]}    线程ID, 进制与格式化字符串中的 {thread} 相同
+//     {ctx[:key]}           诊断上下文，见 logcontext.hpp
+//     {file} {line} {func}  调用点的源码位置，见 callsite.hpp
+// 与格式化字符串相同，%{ 与 %} 表示字面的 '{' 与 '}'.
+
+#pragma once
+
+#ifndef MYLOGGER_LAYOUT_HPP
+#define MYLOGGER_LAYOUT_HPP
+
+#include <chrono>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "formatter.hpp"
+#include "loglevel.hpp"
+
+class Layout {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+
+  private:
+    // 编译后的格式化操作
+    enum class Op { TEXT, MESSAGE, LEVEL, TIME, SUBSECOND, THREAD, CONTEXT, FILE, LINE, FUNC };
+
+    struct Step {
+        Op op;
+        std::string arg;      // TEXT: 文本; TIME: strftime 格式; THREAD: 进制; CONTEXT: 键
+        bool has_arg = false; // THREAD/CONTEXT: 是否指定了参数
+        int digits = 0;       // SUBSECOND: 位数
+
+        // TIME: 上一次渲染的秒及其结果，同一秒内的日志直接复用。没有同步: render() 只由 Logger::dispatch()
+        // 在唯一的格式化线程中调用，在其他线程中渲染同一个 Layout 会产生数据竞争
+        mutable std::time_t cached_second = std::numeric_limits<std::time_t>::min(); // -1 是合法的秒(1969 年)
+        mutable std::string cached;
+    };
+
+  private:
+    std::vector<Step> m_steps;
+
+  private:
+    // 编译模式字符串，格式不正确或缺少 {msg} 时抛出 std::runtime_error
+    explicit Layout(const std::string& pattern);
+
+    // 添加一个文本操作，与前一个文本操作合并
+    void addText(const std::string& text);
+
+    // 编译单个占位符，token 不含两侧的括号
+    void addToken(const std::string& token);
+
+    // 将 message 按布局渲染后追加到 out 中。record 为空时(例如重复日志的汇总信息)线程、上下文与源码位置为空。
+    // 只能在格式化线程中调用，见 Step::cached.
+    void render(std::string& out, const std::string& message, LogLevel level,
+                std::chrono::system_clock::time_point time, const Formatter* record) const;
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_LAYOUT_INL_HPP
+#include "layout-inl.hpp"
+MYLOGGER_LAYOUT_INL_HPP
+#endif // MYLOGGER_LAYOUT_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_LAYOUT_HPP
@@ -0,0 +1,50 @@
+// logcontext 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_LOGCONTEXT_INL_HPP
+#define MYLOGGER_LOGCONTEXT_INL_HPP
+
+#ifndef MYLOGGER_LOGCONTEXT_HPP
+#include "logcontext.hpp"
+#endif // MYLOGGER_LOGCONTEXT_HPP
+
+MYLOGGER_INLINE std::shared_ptr<const LogContext::Fields>& LogContext::current() {
+    static thread_local std::shared_ptr<const Fields> instance;
+    return instance;
+}
+
+MYLOGGER_INLINE const std::string* LogContext::find(const Fields& fields, const std::string& key) {
+    for (const auto& field : fields) {
+        if (field.first == key)
+            return &field.second;
+    }
+    return nullptr;
+}
+
+MYLOGGER_INLINE LogContext::Scope::Scope(const std::string& key, const std::string& value) : m_previous(current()) {
+    // 写时复制: 已被日志引用的快照保持不变
+    auto fields = m_previous ? std::make_shared<Fields>(*m_previous) : std::make_shared<Fields>();
+    bool replaced = false;
+    for (auto& field : *fields) {
+        if (field.first == key) {
+            field.second = value;
+            replaced = true;
+            break;
+        }
+    }
+    if (!replaced)
+        fields->emplace_back(key, value);
+
+    current() = std::move(fields);
+}
+
+MYLOGGER_INLINE LogContext::Scope::~Scope() {
+    current() = std::move(m_previous);
+}
+
+MYLOGGER_INLINE void LogContext::clear() {
+    current().reset();
+}
+
+#endif // MYLOGGER_LOGCONTEXT_INL_HPP
@@ -0,0 +1,87 @@
+// 线程局部的诊断上下文(Mapped Diagnostic Context): 通过 LogContext::Scope 在作用域内添加键值对,
+// 格式化字符串中的 {ctx:key} 会被替换为当前线程中 key 对应的值，{ctx} 会被替换为全部键值对。
+//
+// 上下文以不可变的快照保存，修改时复制一份新的快照(写时复制)。每条日志只复制一次引用计数指针，
+// 字符串只在进入作用域时转换一次，而不是在每条日志中重复转换。
+//
+//     void handle(const Request& request) {
+//         LogContext::Scope request_id("request_id", request.id);
+//         LogContext::Scope tenant("tenant", request.tenant);
+//         Logger::info("[{ctx:request_id}] handling {}\n", request.path); // 或使用 {ctx} 输出全部键值对
+//     }
+
+#pragma once
+
+#ifndef MYLOGGER_LOGCONTEXT_HPP
+#define MYLOGGER_LOGCONTEXT_HPP
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "argformatter.hpp"
+
+class LogContext {
+  private:
+    // 友元类声明，仅允许 Logger 与 Formatter 类访问私有成员
+    friend class Logger;
+    friend class Formatter;
+
+  private:
+    // 上下文快照: 按加入顺序排列的键值对，创建后不再修改
+    using Fields = std::vector<std::pair<std::string, std::string>>;
+
+    // 当前线程的上下文，为空指针表示没有上下文
+    static std::shared_ptr<const Fields>& current();
+
+    // 在快照中查找 key, 找不到时返回 nullptr
+    static const std::string* find(const Fields& fields, const std::string& key);
+
+  public:
+    // 在作用域内为当前线程添加(或覆盖) key=value, 析构时恢复进入作用域之前的上下文。
+    // 必须在创建它的线程中析构，且按照后进先出的顺序析构(作为局部变量使用即可)。
+    class Scope {
+      private:
+        std::shared_ptr<const Fields> m_previous;
+
+      public:
+        Scope(const std::string& key, const std::string& value);
+
+        // 其他类型的值通过 ArgFormatter 转换为字符串
+        template <typename T>
+        Scope(const std::string& key, const T& value);
+
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // 清空当前线程的上下文，例如线程池中的线程开始处理新任务时
+    static void clear();
+};
+
+#define MYLOGGER_CONTEXT_CONCAT_IMPL(a, b) a##b
+#define MYLOGGER_CONTEXT_CONCAT(a, b) MYLOGGER_CONTEXT_CONCAT_IMPL(a, b)
+
+// 在当前作用域内添加一个上下文字段，无需为 Scope 对象命名
+// 用法: MYLOGGER_CONTEXT("request_id", id);
+#define MYLOGGER_CONTEXT(key, value) LogContext::Scope MYLOGGER_CONTEXT_CONCAT(mylogger_context_, __LINE__)(key, value)
+
+template <typename T>
+LogContext::Scope::Scope(const std::string& key, const T& value) : Scope(key, [&] {
+    std::string text;
+    ArgFormatter<T>::format(text, value, FormatSpec());
+    return text;
+}()) {
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_LOGCONTEXT_INL_HPP
+#include "logcontext-inl.hpp"
+MYLOGGER_LOGCONTEXT_INL_HPP
+#endif // MYLOGGER_LOGCONTEXT_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_LOGCONTEXT_HPP
@@ -9,458 +9,538 @@
 #include "logger.hpp"
 #endif // MYLOGGER_LOGGER_HPP
 
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "controller.hpp"
+#include "formatterpool.hpp"
 #include "logwriter.hpp"
+#include "sharedsink.hpp"
 #include "threadspool.hpp"
 
-inline Logger::Logger()
-    : m_level(LogLevel::INFO), m_file_name("app.log"), m_console_output_enabled(true), m_file_output_enabled(false) {
+MYLOGGER_INLINE Logger::Logger()
+    : m_config(
+          new Config{LogLevel::INFO, "app.log", true, false, 0, 0, std::chrono::milliseconds(0), nullptr, nullptr}),
+      m_last_level(LogLevel::INFO), m_last_console_output(false), m_last_file_output(false), m_last_config(nullptr),
+      m_repeat_count(0), m_last_producer(0), m_rate_limited_count(0), m_deduplicated_count(0) {
+    // 保证 FormatterPool 先于 Logger 构造完成，从而后于 Logger 与 ThreadsPool 析构
+    FormatterPool::getFormatterPool();
+    // 修改配置时遍历生产者线程的登记表，同样需要后于 Logger 析构
+    ProducerCounters::registry();
+
+    // 线程池析构时输出仍被折叠的重复日志，未调用 flush() 直接退出时汇总信息与计数不会丢失
+    ThreadsPool::drainHook().store(
+        [] {
+            Logger& logger = getLogger();
+            flushRepeated(logger, logger.m_last_producer);
+        },
+        std::memory_order_release);
+    ThreadsPool::timerHook().store(&Logger::flushExpired, std::memory_order_release);
+
+#ifdef __linux__
+    // fork() 期间持有配置锁，子进程不会继承一个被其他线程锁住的 m_config_mtx
+    pthread_atfork([] { getLogger().m_config_mtx.lock(); }, [] { getLogger().m_config_mtx.unlock(); },
+                   [] { getLogger().m_config_mtx.unlock(); });
+#endif
 }
 
-inline Logger& Logger::getLogger() {
-    static Logger instance;
-    return instance;
+MYLOGGER_INLINE Logger::~Logger() {
+    delete m_config.load(std::memory_order_relaxed);
 }
 
-inline void Logger::setLevel(LogLevel level) {
-    static Logger& logger = getLogger();
-    logger.m_level = level;
+MYLOGGER_INLINE Logger& Logger::getLogger() {
+    static Logger instance;
+    return instance;
 }
 
-inline void Logger::enableConsole(bool enabled) {
+template <typename Modifier>
+void Logger::updateConfig(Modifier&& modifier) {
     static Logger& logger = getLogger();
-    logger.m_console_output_enabled = enabled;
-}
 
-inline void Logger::enabledFile(bool enabled) {
-    static Logger& logger = getLogger();
-    logger.m_file_output_enabled = enabled;
+    std::vector<std::unique_ptr<const Config>> unpinned;
+    {
+        std::unique_lock<std::mutex> lock(logger.m_config_mtx);
+        const Config* old_config = logger.m_config.load(std::memory_order_relaxed);
+        Config* new_config = new Config(*old_config);
+        modifier(*new_config);
+        // 与 ConfigPin 中的 seq_cst 操作配对: 生产者要么在检查时已看到新配置，要么它持有的旧配置在这里被看到
+        logger.m_config.store(new_config, std::memory_order_seq_cst);
+        logger.m_retired_configs.emplace_back(old_config);
+        unpinned = logger.takeUnpinnedConfigs();
+    }
+    // fork 处理函数先持有线程池各队列的锁再获取 m_config_mtx, 因此提交任务之前必须释放 m_config_mtx
+    logger.releaseConfigs(std::move(unpinned));
 }
 
-inline void Logger::setFile(const std::string& file_name) {
-    static Logger& logger = getLogger();
-    logger.m_file_name = file_name;
+MYLOGGER_INLINE std::vector<std::unique_ptr<const Logger::Config>> Logger::takeUnpinnedConfigs() {
+    std::vector<std::unique_ptr<const Config>> unpinned;
+    ProducerCounters::Registry& reg = ProducerCounters::registry();
+    std::unique_lock<std::mutex> lock(reg.mtx);
+    auto pinned = [&reg](const Config* config) {
+        for (const ProducerCounters* counters : reg.threads) {
+            if (counters->m_config_pin.load(std::memory_order_seq_cst) == config)
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<std::unique_ptr<const Config>> still_pinned;
+    for (std::unique_ptr<const Config>& config : m_retired_configs) {
+        if (pinned(config.get()))
+            still_pinned.push_back(std::move(config));
+        else
+            unpinned.push_back(std::move(config));
+    }
+    m_retired_configs = std::move(still_pinned);
+    return unpinned;
 }
 
-template <typename... Args>
-void Logger::debug(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::DEBUG)
-        return;
-
-    if (!(logger.m_console_output_enabled || logger.m_file_output_enabled))
+MYLOGGER_INLINE void Logger::releaseConfigs(std::vector<std::unique_ptr<const Config>> configs) {
+    if (configs.empty())
         return;
 
-    bool console_output_enabled = logger.m_console_output_enabled;
-    bool file_output_enabled = logger.m_file_output_enabled;
-    std::string file_name = logger.m_file_name;
-
-    // 由于 Formatter 在实例化的时候会获取线程id，所以这里不能在线程池中实例化，只能在主线程中实例化，然后在线程池中传入参数
-    // 没必要用智能指针啦，就只在线程池中用一次，用完马上就 delete 掉啦
-    Formatter* formatter(new Formatter(LogLevel::DEBUG));
-    if (!formatter) {
-        throw std::bad_alloc();
+    {
+        // 线程池尚未构造时没有任何任务引用旧配置; 持有 opts.mtx 期间线程池也不会开始构造
+        ThreadsPool::Options& opts = ThreadsPool::options();
+        std::unique_lock<std::mutex> lock(opts.mtx);
+        if (!opts.started)
+            return;
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            if (console_output_enabled) {
-                ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-            }
-
-            if (file_output_enabled) {
-                ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-            }
-        },
-        args...);
-};
-
-template <typename... Args>
-void Logger::info(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::INFO)
+    ThreadsPool* pool = ThreadsPool::forkTarget().load(std::memory_order_acquire);
+    if (!pool) {
+        // 线程池正在析构，队列中的任务可能仍在使用旧配置，留到 Logger 析构时释放
+        std::unique_lock<std::mutex> lock(m_config_mtx);
+        for (std::unique_ptr<const Config>& config : configs)
+            m_retired_configs.push_back(std::move(config));
         return;
-
-    if (!(logger.m_console_output_enabled || logger.m_file_output_enabled))
-        return;
-
-    bool console_output_enabled = logger.m_console_output_enabled;
-    bool file_output_enabled = logger.m_file_output_enabled;
-    std::string file_name = logger.m_file_name;
-
-    Formatter* formatter(new Formatter(LogLevel::INFO));
-    if (!formatter) {
-        throw std::bad_alloc();
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            if (console_output_enabled) {
-                ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-            }
-
-            if (file_output_enabled) {
-                ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-            }
-        },
-        args...);
+    // 不属于任何生产者的普通任务在之前提交的所有任务(包括优先通道中的)之后执行。
+    // 旧配置若仍是重复日志折叠所记录的配置，则由 m_last_config_owner 接管，直到折叠状态改用其他配置。
+    auto retired = std::make_shared<std::vector<std::unique_ptr<const Config>>>(std::move(configs));
+    pool->addFormatTask(ThreadsPool::Lane::NORMAL, 0, [retired] {
+        Logger& logger = getLogger();
+        for (std::unique_ptr<const Config>& config : *retired) {
+            if (config.get() == logger.m_last_config)
+                logger.m_last_config_owner = std::move(config);
+        }
+        retired->clear();
+    });
 }
 
-template <typename... Args>
-void Logger::warning(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::WARNING)
-        return;
-
-    if (!(logger.m_console_output_enabled || logger.m_file_output_enabled))
+MYLOGGER_INLINE Logger::ConfigPin::ConfigPin()
+    : m_slot(ProducerCounters::local().m_config_pin),
+      m_config(static_cast<const Config*>(m_slot.load(std::memory_order_relaxed))), m_owner(m_config == nullptr) {
+    if (!m_owner)
         return;
 
-    bool console_output_enabled = logger.m_console_output_enabled;
-    bool file_output_enabled = logger.m_file_output_enabled;
-    std::string file_name = logger.m_file_name;
-
-    Formatter* formatter(new Formatter(LogLevel::WARNING));
-    if (!formatter) {
-        throw std::bad_alloc();
+    // 发布引用之后再次读取配置指针，两次一致时修改配置的线程必然能看到这个引用
+    std::atomic<const Config*>& current = getLogger().m_config;
+    m_config = current.load(std::memory_order_acquire);
+    while (true) {
+        m_slot.store(m_config, std::memory_order_seq_cst);
+        const Config* again = current.load(std::memory_order_seq_cst);
+        if (again == m_config)
+            break;
+        m_config = again;
     }
-
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            if (console_output_enabled) {
-                ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-            }
-
-            if (file_output_enabled) {
-                ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-            }
-        },
-        args...);
 }
 
-template <typename... Args>
-void Logger::error(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::ERROR)
-        return;
-
-    if (!(logger.m_console_output_enabled || logger.m_file_output_enabled))
-        return;
+MYLOGGER_INLINE Logger::ConfigPin::~ConfigPin() {
+    if (m_owner)
+        m_slot.store(nullptr, std::memory_order_release);
+}
 
-    bool console_output_enabled = logger.m_console_output_enabled;
-    bool file_output_enabled = logger.m_file_output_enabled;
-    std::string file_name = logger.m_file_name;
+MYLOGGER_INLINE void Logger::setLevel(LogLevel level) {
+    updateConfig([&](Config& config) { config.level = level; });
+}
 
-    Formatter* formatter(new Formatter(LogLevel::ERROR));
-    if (!formatter) {
-        throw std::bad_alloc();
-    }
+MYLOGGER_INLINE void Logger::enableConsole(bool enabled) {
+    updateConfig([&](Config& config) { config.console_output_enabled = enabled; });
+}
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
+MYLOGGER_INLINE void Logger::enabledFile(bool enabled) {
+    updateConfig([&](Config& config) { config.file_output_enabled = enabled; });
+}
 
-            if (console_output_enabled) {
-                ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-            }
+MYLOGGER_INLINE void Logger::setFile(const std::string& file_name) {
+    updateConfig([&](Config& config) { config.file_name = file_name; });
+}
 
-            if (file_output_enabled) {
-                ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-            }
-        },
-        args...);
-}
-
-template <typename... Args>
-void Logger::log(LogLevel level, const std::string& message, const Args&... args) {
-    switch (level) {
-    case LogLevel::DEBUG:
-        debug(message, args...);
-        break;
-    case LogLevel::INFO:
-        info(message, args...);
-        break;
-    case LogLevel::WARNING:
-        warning(message, args...);
-        break;
-    case LogLevel::ERROR:
-        error(message, args...);
-        break;
-    default:
-        break;
-    }
+MYLOGGER_INLINE void Logger::setSampling(std::size_t queue_threshold, unsigned int one_in) {
+    updateConfig([&](Config& config) {
+        config.sampling_threshold = queue_threshold;
+        config.sampling_rate = one_in;
+    });
 }
 
-template <typename... Args>
-void Logger::debugc(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
+MYLOGGER_INLINE void Logger::setDedupWindow(std::chrono::milliseconds window) {
+    updateConfig([&](Config& config) { config.dedup_window = window; });
+}
 
-    if (logger.m_level > LogLevel::DEBUG)
-        return;
+MYLOGGER_INLINE void Logger::setLayout(const std::string& pattern) {
+    std::shared_ptr<const Layout> layout(pattern.empty() ? nullptr : new Layout(pattern));
+    updateConfig([&](Config& config) {
+        config.console_layout = layout;
+        config.file_layout = layout;
+    });
+}
 
-    if (!(logger.m_console_output_enabled))
-        return;
+MYLOGGER_INLINE void Logger::setConsoleLayout(const std::string& pattern) {
+    std::shared_ptr<const Layout> layout(pattern.empty() ? nullptr : new Layout(pattern));
+    updateConfig([&](Config& config) { config.console_layout = layout; });
+}
 
-    Formatter* formatter(new Formatter(LogLevel::DEBUG));
-    if (!formatter) {
-        throw std::bad_alloc();
-    }
+MYLOGGER_INLINE void Logger::setFileLayout(const std::string& pattern) {
+    std::shared_ptr<const Layout> layout(pattern.empty() ? nullptr : new Layout(pattern));
+    updateConfig([&](Config& config) { config.file_layout = layout; });
+}
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
+MYLOGGER_INLINE void Logger::setBackendOptions(const BackendOptions& options) {
+    getLogger();
+    ThreadsPool::configure(options);
+}
 
-            ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-        },
-        args...);
+MYLOGGER_INLINE void Logger::setConsoleOptions(const ConsoleOptions& options) {
+    LogWriter::setConsoleOptions(options);
 }
 
-template <typename... Args>
-void Logger::infoc(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
+MYLOGGER_INLINE void Logger::setFileIndex(const FileIndexOptions& options) {
+    FileIndex::setOptions(options);
+}
 
-    if (logger.m_level > LogLevel::INFO)
-        return;
+MYLOGGER_INLINE void Logger::flush() {
+    auto done = std::make_shared<std::promise<void>>();
+    std::future<void> future = done->get_future();
+    postFlush([done] { done->set_value(); });
+    future.wait();
+}
 
-    if (!(logger.m_console_output_enabled))
-        return;
+MYLOGGER_INLINE void Logger::postFlush(std::function<void(void)> on_done) {
+    getLogger();
+
+    // 三个队列都是先进先出的: 在格式化队列末尾插入一个任务，由它再向两个输出队列的末尾各插入一个任务,
+    // 两个输出任务都执行完毕时，之前提交的日志必然已全部输出。优先通道中的任务总是先于其后提交的普通任务执行,
+    // 因此这些任务放在普通通道中即可
+    auto remaining = std::make_shared<std::atomic<int>>(2);
+    ThreadsPool::getThreadsPool().addFormatTask(ThreadsPool::Lane::NORMAL, 0, [on_done, remaining] {
+        Logger& logger = getLogger();
+        flushRepeated(logger, logger.m_last_producer);
+
+        auto finish = [on_done, remaining] {
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                on_done();
+        };
+        ThreadsPool::getThreadsPool().addConsoleOutputTask(ThreadsPool::Lane::NORMAL, 0, [finish] {
+            LogWriter::flushConsole();
+            finish();
+        });
+        ThreadsPool::getThreadsPool().addFileOutputTask(ThreadsPool::Lane::NORMAL, 0, finish);
+    });
+}
 
-    Formatter* formatter(new Formatter(LogLevel::INFO));
-    if (!formatter) {
-        throw std::bad_alloc();
-    }
+MYLOGGER_INLINE void Logger::startControl(const std::string& socket_path, const std::string& config_file) {
+    getLogger(); // 保证 Logger 先于 Controller 构造，从而后于 Controller 析构
+    Controller::getController().start(socket_path, config_file);
+}
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
+MYLOGGER_INLINE void Logger::startSharedCollector(const std::string& shm_name, std::size_t capacity) {
+    getLogger();
+    SharedSink::getSharedSink().start(shm_name, capacity);
+}
 
-            ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-        },
-        args...);
+MYLOGGER_INLINE void Logger::attachSharedSink(const std::string& shm_name) {
+    getLogger();
+    SharedSink::getSharedSink().attach(shm_name);
 }
 
-template <typename... Args>
-void Logger::warningc(const std::string& message, const Args&... args) {
+MYLOGGER_INLINE LoggerStats Logger::stats() {
     Logger& logger = getLogger();
+    ThreadsPool& pool = ThreadsPool::getThreadsPool();
+    LogWriter::Metrics& writer = LogWriter::metrics();
+
+    LoggerStats result;
+    ProducerCounters::collect(result);
+    result.rate_limited = rateLimitedCount();
+
+    result.formatted = pool.m_formatted.get();
+    result.deduplicated = logger.m_deduplicated_count.load(std::memory_order_relaxed);
+    result.format_time = pool.m_format_time.snapshot();
+
+    result.console_written = writer.console_written.get();
+    result.console_bytes = writer.console_bytes.get();
+    result.console_dropped = writer.console_dropped.get();
+    result.shared_dropped = SharedSink::getSharedSink().dropped();
+    result.file_written = writer.file_written.get();
+    result.file_bytes = writer.file_bytes.get();
+    result.console_write_time = writer.console_write_time.snapshot();
+    result.file_write_time = writer.file_write_time.snapshot();
+
+    result.format_queue_depth = pool.m_format_queue_size.load(std::memory_order_relaxed);
+    result.format_queue_high_watermark = pool.m_format_queue_high_watermark.get();
+    result.console_queue_high_watermark = pool.m_console_queue_high_watermark.get();
+    result.file_queue_high_watermark = pool.m_file_queue_high_watermark.get();
+    result.arena_used_bytes = LogArena::getArena().usedBytes();
+    result.arena_fallbacks = LogArena::getArena().fallbacks();
+
+    return result;
+}
 
-    if (logger.m_level > LogLevel::WARNING)
-        return;
-
-    if (!(logger.m_console_output_enabled))
-        return;
-
-    Formatter* formatter(new Formatter(LogLevel::WARNING));
-    if (!formatter) {
-        throw std::bad_alloc();
+MYLOGGER_INLINE void Logger::dumpStats(const std::string& file_name) {
+    std::string temp_name = file_name + ".tmp";
+    {
+        std::ofstream file(temp_name, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open stats file: " + temp_name + ".");
+        }
+        file << stats().toPrometheus();
     }
+    if (std::rename(temp_name.c_str(), file_name.c_str()) != 0) {
+        throw std::runtime_error("Failed to rename stats file to " + file_name + ".");
+    }
+}
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-        },
-        args...);
+MYLOGGER_INLINE void Logger::enableFlightRecorder(const FlightRecorderOptions& options) {
+    getLogger();
+    FlightRecorder::enable(options);
 }
 
-template <typename... Args>
-void Logger::errorc(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
+MYLOGGER_INLINE void Logger::dumpFlightRecorder(const std::string& file_name) {
+    FlightRecorder* recorder = FlightRecorder::instance().load(std::memory_order_acquire);
+    if (!recorder) {
+        throw std::runtime_error("Flight recorder is not enabled.");
+    }
+    recorder->dump(file_name);
+}
 
-    if (logger.m_level > LogLevel::ERROR)
-        return;
+MYLOGGER_INLINE unsigned long long Logger::rateLimitedCount() {
+    // 已输出汇总信息的部分 + 各调用点尚未汇总的部分
+    unsigned long long count = getLogger().m_rate_limited_count.load(std::memory_order_relaxed);
+    for (CallSite* site = CallSite::head().load(std::memory_order_acquire); site; site = site->m_next) {
+        count += site->m_suppressed.load(std::memory_order_relaxed);
+    }
+    return count;
+}
 
-    if (!(logger.m_console_output_enabled))
-        return;
+MYLOGGER_INLINE unsigned long long Logger::deduplicatedCount() {
+    return getLogger().m_deduplicated_count.load(std::memory_order_relaxed);
+}
 
-    Formatter* formatter(new Formatter(LogLevel::ERROR));
-    if (!formatter) {
-        throw std::bad_alloc();
+MYLOGGER_INLINE void Logger::dispatch(const std::string& message, LogLevel level, std::uint64_t producer,
+                                      std::chrono::system_clock::time_point time, const Formatter* record,
+                                      bool console, bool file, const Config& config,
+                                      const std::shared_ptr<const Blob>& blob) {
+    ThreadsPool& pool = ThreadsPool::getThreadsPool();
+    ThreadsPool::Lane lane = pool.laneOf(level);
+
+    // 布局在格式化线程中渲染，控制台与文件使用同一个布局时只渲染一次。
+    // 不能移到生产者或输出线程中: Layout 的时间缓存只允许格式化线程访问(见 Layout::Step)。
+    const Layout* console_layout = console ? config.console_layout.get() : nullptr;
+    const Layout* file_layout = file ? config.file_layout.get() : nullptr;
+    std::string console_text;
+    std::string file_text;
+    if (console_layout)
+        console_layout->render(console_text, message, level, time, record);
+    if (file_layout == console_layout)
+        file_text = console_text;
+    else if (file_layout)
+        file_layout->render(file_text, message, level, time, record);
+
+    if (console) {
+        const std::string& text = console_layout ? console_text : message;
+        if (blob)
+            pool.addConsoleOutputTask(lane, producer, LogWriter::writeBlobToConsole, level, text, blob);
+        else
+            pool.addConsoleOutputTask(lane, producer, LogWriter::writeToConsole, level, text);
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            ThreadsPool::getThreadsPool().addConsoleOutputTask(LogWriter::writeToConsole, formated_string);
-        },
-        args...);
-}
-
-template <typename... Args>
-void Logger::logc(LogLevel level, const std::string& message, const Args&... args) {
-    switch (level) {
-    case LogLevel::DEBUG:
-        debugc(message, args...);
-        break;
-    case LogLevel::INFO:
-        infoc(message, args...);
-        break;
-    case LogLevel::WARNING:
-        warningc(message, args...);
-        break;
-    case LogLevel::ERROR:
-        errorc(message, args...);
-        break;
-    default:
-        break;
+    if (file) {
+        // 多进程模式下直接写入共享缓冲区，由收集进程写入文件。共享缓冲区只接受连续的文本，blob 在这里编码。
+        const std::string& text = file_layout ? file_text : message;
+        SharedSink* shared = SharedSink::producer().load(std::memory_order_acquire);
+        if (shared && blob) {
+            std::string encoded = text;
+            blob->appendTo(encoded);
+            shared->push(config.file_name, encoded);
+        } else if (shared) {
+            shared->push(config.file_name, text);
+        } else if (blob) {
+            pool.addFileOutputTask(lane, producer, LogWriter::writeBlobToFile, config.file_name, level, time, text,
+                                   blob);
+        } else {
+            pool.addFileOutputTask(lane, producer, LogWriter::writeToFile, config.file_name, level, time, text);
+        }
     }
 }
 
-template <typename... Args>
-void Logger::debugf(const std::string& message, const Args&... args) {
+MYLOGGER_INLINE void Logger::outputBlob(Formatter* formatter, const std::shared_ptr<const Blob>& blob, bool console,
+                                        bool file, const Config& config) {
     Logger& logger = getLogger();
+    ThreadsPool::getThreadsPool().m_formatted.add();
 
-    if (logger.m_level > LogLevel::DEBUG)
-        return;
+    // 先输出之前被折叠的汇总信息以保持顺序，并使之后的日志不再与 blob 之前的日志折叠
+    flushRepeated(logger, formatter->m_producer);
+    logger.m_last_time = std::chrono::steady_clock::time_point();
 
-    if (!(logger.m_file_output_enabled))
+    dispatch(formatter->formatedString(), formatter->m_level, formatter->m_producer, formatter->m_time, formatter,
+             console, file, config, blob);
+    FormatterPool::getFormatterPool().release(formatter);
+}
+
+MYLOGGER_INLINE void Logger::flushRepeated(Logger& logger, std::uint64_t producer) {
+    if (logger.m_repeat_count == 0)
         return;
 
-    std::string file_name = logger.m_file_name;
+    logger.m_deduplicated_count.fetch_add(logger.m_repeat_count, std::memory_order_relaxed);
+    // 被折叠的日志可能来自多个线程。汇总信息与这一段的第一条日志等级相同、位于同一通道，因此排在它之后;
+    // 记在 producer 名下只让该生产者之后的日志排在汇总信息之后，不会阻塞其他生产者的高优先级日志
+    dispatch("Last message repeated " + std::to_string(logger.m_repeat_count) + " times.\n", logger.m_last_level,
+             producer, logger.m_repeat_time, nullptr, logger.m_last_console_output, logger.m_last_file_output,
+             *logger.m_last_config);
+    logger.m_repeat_count = 0;
+}
 
-    Formatter* formatter(new Formatter(LogLevel::DEBUG));
-    if (!formatter) {
-        throw std::bad_alloc();
+MYLOGGER_INLINE std::chrono::steady_clock::time_point Logger::flushExpired() {
+    Logger& logger = getLogger();
+    auto now = std::chrono::steady_clock::now();
+    auto next = std::chrono::steady_clock::time_point::max();
+
+    // 时间窗口已过的一段重复日志不会再增加，之后的相同日志会单独输出
+    if (logger.m_repeat_count > 0) {
+        std::chrono::milliseconds dedup_window = logger.m_config.load(std::memory_order_acquire)->dedup_window;
+        if (now - logger.m_last_time >= dedup_window)
+            flushRepeated(logger, logger.m_last_producer);
+        else
+            next = logger.m_last_time + dedup_window;
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-        },
-        args...);
-};
+    // 丢弃计数在该调用点的下一条日志本应被允许输出之后仍未被带出，说明之后没有再从这里记录日志
+    if (CallSite::rateLimited().load(std::memory_order_relaxed)) {
+        if (now >= logger.m_next_sweep) {
+            logger.m_next_sweep = now + kSuppressedSweepInterval;
+            std::int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+            for (CallSite* site = CallSite::head().load(std::memory_order_acquire); site; site = site->m_next) {
+                if (site->m_suppressed.load(std::memory_order_relaxed) == 0)
+                    continue;
+                std::int64_t admit_ns = site->admitTime();
+                if (admit_ns > now_ns) {
+                    logger.m_next_sweep = std::min(
+                        logger.m_next_sweep, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(admit_ns)));
+                    continue;
+                }
+                unsigned long long suppressed = site->takeSuppressed();
+                if (suppressed > 0)
+                    reportSuppressed(*site, site->m_level.load(std::memory_order_relaxed),
+                                     site->m_sinks.load(std::memory_order_relaxed), suppressed);
+            }
+        }
+        next = std::min(next, logger.m_next_sweep);
+    }
+    return next;
+}
 
-template <typename... Args>
-void Logger::infof(const std::string& message, const Args&... args) {
+MYLOGGER_INLINE void Logger::output(Formatter* formatter, bool console, bool file, const Config& config) {
     Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::INFO)
+    LogLevel level = formatter->m_level;
+    ThreadsPool::getThreadsPool().m_formatted.add();
+    // 当前配置即使随后被替换，也要等到格式化线程执行完手头的任务才会释放
+    std::chrono::milliseconds dedup_window = logger.m_config.load(std::memory_order_acquire)->dedup_window;
+
+    if (dedup_window.count() <= 0) {
+        flushRepeated(logger, formatter->m_producer);
+        dispatch(formatter->formatedString(), level, formatter->m_producer, formatter->m_time, formatter, console, file,
+                 config);
+        FormatterPool::getFormatterPool().release(formatter);
         return;
+    }
 
-    if (!(logger.m_file_output_enabled))
+    // 内容相同、输出目标相同且仍在时间窗口内: 只计数, 不输出
+    auto now = std::chrono::steady_clock::now();
+    std::string content = formatter->contentString();
+    if (now - logger.m_last_time < dedup_window && content == logger.m_last_content && level == logger.m_last_level &&
+        console == logger.m_last_console_output && file == logger.m_last_file_output && logger.m_last_config &&
+        config.file_name == logger.m_last_config->file_name) {
+        logger.m_repeat_count++;
+        logger.m_last_producer = formatter->m_producer;
+        logger.m_repeat_time = formatter->m_time;
+        FormatterPool::getFormatterPool().release(formatter);
         return;
-
-    std::string file_name = logger.m_file_name;
-
-    Formatter* formatter(new Formatter(LogLevel::INFO));
-    if (!formatter) {
-        throw std::bad_alloc();
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-        },
-        args...);
-};
+    flushRepeated(logger, formatter->m_producer);
+    dispatch(formatter->formatedString(), level, formatter->m_producer, formatter->m_time, formatter, console, file,
+             config);
+    logger.m_last_producer = formatter->m_producer;
+    FormatterPool::getFormatterPool().release(formatter);
+
+    logger.m_last_content = std::move(content);
+    logger.m_last_level = level;
+    logger.m_last_console_output = console;
+    logger.m_last_file_output = file;
+    if (logger.m_last_config_owner && logger.m_last_config_owner.get() != &config)
+        logger.m_last_config_owner.reset();
+    logger.m_last_config = &config;
+    logger.m_last_time = now;
+}
 
-template <typename... Args>
-void Logger::warningf(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
+MYLOGGER_INLINE bool Logger::admit(CallSite& site, LogLevel level, unsigned int sinks) {
+    if (ConfigPin().get()->level > level)
+        return false;
+    return site.allow(level, sinks);
+}
 
-    if (logger.m_level > LogLevel::WARNING)
-        return;
+MYLOGGER_INLINE void Logger::reportSuppressed(CallSite& site, LogLevel level, unsigned int sinks,
+                                              unsigned long long suppressed) {
+    getLogger().m_rate_limited_count.fetch_add(suppressed, std::memory_order_relaxed);
+
+    // 汇总信息属于该调用点。丢弃的条数转入总数之后只能通过汇总信息输出，因此汇总信息不参与负载采样
+    CallSite::Scope scope(&site.m_location);
+    std::string message = "{} messages from this call site were suppressed by rate limit.\n";
+    if (sinks == kConsole)
+        submit<kConsole, false>(level, message, suppressed);
+    else if (sinks == kFile)
+        submit<kFile, false>(level, message, suppressed);
+    else
+        submit<kAllSinks, false>(level, message, suppressed);
+}
 
-    if (!(logger.m_file_output_enabled))
-        return;
+MYLOGGER_INLINE bool Logger::sampled(const Config& config) {
+    if (config.sampling_threshold == 0)
+        return true;
 
-    std::string file_name = logger.m_file_name;
+    std::size_t depth = ThreadsPool::getThreadsPool().m_format_queue_size.load(std::memory_order_relaxed);
+    if (depth < config.sampling_threshold)
+        return true;
 
-    Formatter* formatter(new Formatter(LogLevel::WARNING));
-    if (!formatter) {
-        throw std::bad_alloc();
+    unsigned int one_in = config.sampling_rate;
+    if (one_in == 0) {
+        one_in = static_cast<unsigned int>(depth / config.sampling_threshold) + 1;
     }
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
-
-            ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-        },
-        args...);
-};
-
-template <typename... Args>
-void Logger::errorf(const std::string& message, const Args&... args) {
-    Logger& logger = getLogger();
-
-    if (logger.m_level > LogLevel::ERROR)
-        return;
-
-    if (!(logger.m_file_output_enabled))
-        return;
+    // 每个线程独立计数，避免共享缓存行
+    static thread_local unsigned int counter = 0;
+    if (++counter % one_in == 0)
+        return true;
 
-    std::string file_name = logger.m_file_name;
+    ProducerCounters::local().m_sampled_out.add();
+    return false;
+}
 
-    Formatter* formatter(new Formatter(LogLevel::ERROR));
-    if (!formatter) {
-        throw std::bad_alloc();
-    }
+MYLOGGER_INLINE bool Logger::accepted(const Config& config, LogLevel level, unsigned int sinks, bool sampling) {
+    if (config.level > level)
+        return false;
 
-    ThreadsPool::getThreadsPool().addFormatTask(
-        [=](const Args... args) {
-            formatter->parseFormatString(message, args...);
-            std::string formated_string = formatter->formatedString();
-            delete formatter;
+    if (sampling && level <= LogLevel::INFO && !sampled(config))
+        return false;
 
-            ThreadsPool::getThreadsPool().addFileOutputTask(LogWriter::writeToFile, file_name, formated_string);
-        },
-        args...);
-};
-
-template <typename... Args>
-void Logger::logf(LogLevel level, const std::string& message, const Args&... args) {
-    switch (level) {
-    case LogLevel::DEBUG:
-        debugf(message, args...);
-        break;
-    case LogLevel::INFO:
-        infof(message, args...);
-        break;
-    case LogLevel::WARNING:
-        warningf(message, args...);
-        break;
-    case LogLevel::ERROR:
-        errorf(message, args...);
-        break;
-    default:
-        break;
-    }
+    return ((sinks & kConsole) && config.console_output_enabled) || ((sinks & kFile) && config.file_output_enabled);
 }
 
 #endif // MYLOGGER_LOGGER_INL_HPP
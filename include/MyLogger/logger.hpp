@@ -5,26 +5,180 @@
 #ifndef MYLOGGER_LOGGER_HPP
 #define MYLOGGER_LOGGER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "common.hpp"
+#include "awaitable.hpp"
+#include "blob.hpp"
+#include "callsite.hpp"
+#include "fileindex.hpp"
+#include "flightrecorder.hpp"
 #include "formatter.hpp"
+#include "formatterpool.hpp"
+#include "layout.hpp"
+#include "logcontext.hpp"
 #include "loglevel.hpp"
+#include "logwriter.hpp"
+#include "stats.hpp"
+#include "threadoptions.hpp"
+#include "threadspool.hpp"
 
 class Logger {
   private:
-    LogLevel m_level;
-    std::string m_file_name;
-    bool m_console_output_enabled;
-    bool m_file_output_enabled;
+    // 日志配置。配置对象一经发布便不再修改，修改配置时复制一份新的配置并原子地替换指针(RCU)，
+    // 因此日志调用只需一次 acquire 读取即可获得一致的配置，且不需要拷贝文件名。
+    struct Config {
+        LogLevel level;
+        std::string file_name;
+        bool console_output_enabled;
+        bool file_output_enabled;
+
+        // 负载采样: 格式化队列长度达到 sampling_threshold 时，DEBUG/INFO 日志每 sampling_rate 条仅保留一条
+        std::size_t sampling_threshold; // 0 表示不采样
+        unsigned int sampling_rate;     // 0 表示根据队列长度自适应
+
+        // 重复日志折叠的时间窗口，0 表示不折叠
+        std::chrono::milliseconds dedup_window;
+
+        // 控制台与文件的输出布局，为空时直接输出格式化后的日志。布局编译后不再修改，新旧配置共享同一个对象
+        std::shared_ptr<const Layout> console_layout;
+        std::shared_ptr<const Layout> file_layout;
+    };
+
+  private:
+    std::atomic<const Config*> m_config; // 当前生效的配置
+    std::mutex m_config_mtx;             // 串行化配置的修改
+
+    // 被替换下来、仍被生产者线程持有(见 ConfigPin)的旧配置，在下一次修改配置时重新检查。
+    // 线程池析构期间替换下来的配置也留在这里，Logger 总是先于 ThreadsPool 构造，因此析构时所有任务都已处理完毕。
+    std::vector<std::unique_ptr<const Config>> m_retired_configs;
+
+    // 生产者线程对配置的引用(hazard pointer): 从读取配置到格式化任务入队期间持有，期间该配置不会被释放。
+    // 嵌套的日志调用(例如可调用对象参数中记录日志)沿用外层已持有的配置。
+    class ConfigPin {
+      private:
+        std::atomic<const void*>& m_slot;
+        const Config* m_config;
+        bool m_owner;
+
+      public:
+        ConfigPin();
+        ~ConfigPin();
+        ConfigPin(const ConfigPin&) = delete;
+        ConfigPin& operator=(const ConfigPin&) = delete;
+
+        const Config* get() const {
+            return m_config;
+        }
+    };
+
+    // 重复日志折叠的状态，仅由格式化线程访问，无需加锁
+    std::string m_last_content;                          // 上一条日志的内容(不含时间戳)
+    LogLevel m_last_level;                               // 上一条日志的等级
+    bool m_last_console_output;                          // 上一条日志是否输出到控制台
+    bool m_last_file_output;                             // 上一条日志是否输出到文件
+    const Config* m_last_config;                         // 上一条日志提交时的配置(文件名与输出布局)
+    std::unique_ptr<const Config> m_last_config_owner;   // 回收时仍是 m_last_config 的旧配置，由格式化线程接管
+    std::chrono::steady_clock::time_point m_last_time;   // 上一条不同日志的输出时间
+    unsigned long long m_repeat_count;                   // 上一条日志被折叠的次数
+    std::uint64_t m_last_producer;                       // 最后一条被折叠(或输出)的日志的生产者编号
+    std::chrono::system_clock::time_point m_repeat_time; // 最后一条被折叠的日志的时间戳，即汇总信息的时间戳
+
+    // 调用点限流汇总的定时检查，仅由格式化线程访问
+    static constexpr std::chrono::milliseconds kSuppressedSweepInterval{1000};
+    std::chrono::steady_clock::time_point m_next_sweep; // 下一次检查各调用点的时间
+
+    std::atomic<unsigned long long> m_rate_limited_count; // 被限流丢弃的日志总数
+    std::atomic<unsigned long long> m_deduplicated_count; // 被折叠的重复日志总数
 
   private:
     Logger();
-    ~Logger() = default;
+    ~Logger();
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
     static Logger& getLogger();
 
+    // 复制当前配置，由 modifier 修改后发布新配置，并回收不再被使用的旧配置
+    template <typename Modifier>
+    static void updateConfig(Modifier&& modifier);
+
+    // 从 m_retired_configs 中取出没有被任何生产者线程持有的旧配置，调用时持有 m_config_mtx
+    std::vector<std::unique_ptr<const Config>> takeUnpinnedConfigs();
+
+    // 释放 takeUnpinnedConfigs() 取出的配置。格式化队列中的任务可能仍在使用它们，因此交给格式化线程，
+    // 在之前提交的任务全部执行之后释放; 线程池尚未启动时直接释放。不能持有 m_config_mtx 调用。
+    void releaseConfigs(std::vector<std::unique_ptr<const Config>> configs);
+
+    // 格式化完成后的输出流程: 折叠重复日志，并分发到各个输出线程。仅由格式化线程调用。
+    // 该函数负责将 formatter 归还到 FormatterPool.
+    // config 为提交日志时的配置，决定输出的文件与布局。
+    static void output(Formatter* formatter, bool console, bool file, const Config& config);
+
+    // 输出并清空被折叠的重复日志的汇总信息。汇总信息属于 producer: 结束这一段重复日志的那条日志的生产者，
+    // 该生产者随后的高优先级日志排在汇总信息之后; 没有这样的日志时(flush、关闭)传入 m_last_producer.
+    static void flushRepeated(Logger& logger, std::uint64_t producer);
+
+    // 格式化线程的定时任务(ThreadsPool::timerHook): 输出时间窗口已过的重复日志汇总，以及之后没有日志带出的
+    // 调用点丢弃计数，返回下一次需要调用的时间。汇总信息不必等到下一条日志、flush() 或关闭时才输出。
+    static std::chrono::steady_clock::time_point flushExpired();
+
+    // 二进制数据的输出流程: 不参与重复日志折叠，将格式化后的首行与 blob 一起分发到各个输出线程。
+    // 该函数负责将 formatter 归还到 FormatterPool.
+    static void outputBlob(Formatter* formatter, const std::shared_ptr<const Blob>& blob, bool console, bool file,
+                           const Config& config);
+
+    // 将 message 分发到对应的输出线程，time 为日志的时间戳(用于文件索引)。
+    // blob 不为空时输出线程将其编码结果追加在 message 之后。
+    // producer 为提交日志的生产者编号，用于在优先通道中保持同一线程的顺序; 0 表示不属于任何生产者。
+    // config 设置了输出布局时按各自的布局包装 message, record 提供线程、上下文与源码位置，可以为空。
+    // 只能在格式化线程中调用(ThreadsPool 只有一个格式化线程，所有调用者都是格式化任务): Layout::render() 的
+    // 时间缓存没有同步，依赖这一点。
+    static void dispatch(const std::string& message, LogLevel level, std::uint64_t producer,
+                         std::chrono::system_clock::time_point time, const Formatter* record, bool console, bool file,
+                         const Config& config, const std::shared_ptr<const Blob>& blob = nullptr);
+
+    // 调用点限流判断: 先检查日志等级，再检查令牌桶。sinks 为日志的输出目标，随丢弃计数记在调用点上
+    static bool admit(CallSite& site, LogLevel level, unsigned int sinks);
+
+    // 将调用点被丢弃的 suppressed 条日志计入总数，并以 level 与 sinks 提交汇总信息
+    static void reportSuppressed(CallSite& site, LogLevel level, unsigned int sinks, unsigned long long suppressed);
+
+    // 负载采样判断，仅用于 DEBUG/INFO 日志。只读取一次队列长度与一个线程局部计数器。
+    static bool sampled(const Config& config);
+
+    // 日志的输出目标，作为 submit() 的模板参数
+    static constexpr unsigned int kConsole = 1;
+    static constexpr unsigned int kFile = 2;
+    static constexpr unsigned int kAllSinks = kConsole | kFile;
+
+    // 判断日志是否需要格式化: 日志等级、负载采样(仅 DEBUG/INFO, sampling 为 false 时跳过)
+    // 以及 sinks 中是否有已开启的输出目标
+    static bool accepted(const Config& config, LogLevel level, unsigned int sinks, bool sampling = true);
+
+    // 所有日志函数共用的实现: 写入飞行记录器，检查配置后提交格式化任务。
+    // 日志等级作为普通参数传入，四个等级与 log() 共用同一份实例，每组参数类型与输出目标只实例化一次。
+    // Sampling 为 false 时不参与负载采样，用于不能丢弃的汇总信息。
+    template <unsigned int Sinks, bool Sampling = true, typename... Args>
+    static void submit(LogLevel level, const std::string& message, const Args&... args);
+
+    // 通过 CallSite 记录日志: 限流，记录源码位置，并输出被限流的日志条数
+    template <unsigned int Sinks, typename... Args>
+    static void submit(CallSite& site, LogLevel level, const std::string& message, const Args&... args);
+
+    // 提交一次刷新: 之前提交的日志全部写入控制台与文件后，在输出线程中调用 on_done
+    static void postFlush(std::function<void(void)> on_done);
+
   public:
     template <typename... Args>
     static void debug(const std::string& message, const Args&... args);
@@ -41,6 +195,21 @@ class Logger {
     template <typename... Args>
     static void log(LogLevel level, const std::string& message, const Args&... args);
 
+    template <typename... Args>
+    static void debug(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void info(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void warning(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void error(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void log(CallSite& site, LogLevel level, const std::string& message, const Args&... args);
+
     template <typename... Args>
     static void debugc(const std::string& message, const Args&... args);
 
@@ -56,6 +225,21 @@ class Logger {
     template <typename... Args>
     static void logc(LogLevel level, const std::string& message, const Args&... args);
 
+    template <typename... Args>
+    static void debugc(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void infoc(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void warningc(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void errorc(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void logc(CallSite& site, LogLevel level, const std::string& message, const Args&... args);
+
     template <typename... Args>
     static void debugf(const std::string& message, const Args&... args);
 
@@ -71,16 +255,405 @@ class Logger {
     template <typename... Args>
     static void logf(LogLevel level, const std::string& message, const Args&... args);
 
+    template <typename... Args>
+    static void debugf(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void infof(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void warningf(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void errorf(CallSite& site, const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static void logf(CallSite& site, LogLevel level, const std::string& message, const Args&... args);
+
+    // 输出二进制数据，见 blob.hpp: 先按 message 与 args 输出一行日志，随后输出 data 的 size 个字节的编码结果。
+    // data 在调用时拷贝一次，之后不再访问; 编码结果由输出线程直接写入输出缓冲区。
+    template <typename... Args>
+    static void blob(LogLevel level, BlobFormat format, const void* data, std::size_t size, const std::string& message,
+                     const Args&... args);
+
+    // 以 hexdump -C 的格式输出二进制数据，等价于 blob(level, BlobFormat::HEXDUMP, ...)
+    template <typename... Args>
+    static void hexdump(LogLevel level, const void* data, std::size_t size, const std::string& message,
+                        const Args&... args);
+
+    // 延迟求值的参数: 参数可以是不带参数的可调用对象，例如 log::debug("{}", [&] { return dump(container); }),
+    // 日志通过日志等级、负载采样与限流的检查之后才在调用线程上调用它。
+    // deferred(callable) 将调用推迟到格式化线程，调用线程只拷贝可调用对象; 它只能按值捕获，或只引用不会再被修改的数据。
+    template <typename Func>
+    static DeferredArg<std::decay_t<Func>> deferred(Func&& callable);
+
   public:
     static void setLevel(LogLevel level);
     static void enableConsole(bool enabled);
     static void enabledFile(bool enabled);
     static void setFile(const std::string& file_name);
+
+    // 设置负载采样: 当格式化队列长度 >= queue_threshold 时，DEBUG/INFO 日志每 one_in 条仅保留一条;
+    // one_in 为 0 时根据队列长度自适应(队列越长丢弃越多)。queue_threshold 为 0 时关闭采样。
+    static void setSampling(std::size_t queue_threshold, unsigned int one_in = 0);
+
+    // 设置重复日志折叠的时间窗口: 窗口内内容相同的连续日志只输出一次，随后输出一条汇总信息。
+    static void setDedupWindow(std::chrono::milliseconds window);
+
+    // 设置输出布局: 日志输出前按模式字符串包装，例如 "[{time:%H:%M:%S.%us}] [{level}] [{thread}] {msg}",
+    // 日志调用中只需写消息本身。模式字符串在这里编译一次，格式不正确时抛出 std::runtime_error, 为空时取消布局。
+    // setLayout() 同时设置控制台与文件。占位符见 layout.hpp.
+    static void setLayout(const std::string& pattern);
+    static void setConsoleLayout(const std::string& pattern);
+    static void setFileLayout(const std::string& pattern);
+
+    // 设置后台线程(格式化、控制台输出、文件输出)的线程名、CPU 亲和性与调度策略。
+    // 必须在第一次输出日志之前调用，否则抛出 std::runtime_error.
+    static void setBackendOptions(const BackendOptions& options);
+
+    // 设置控制台输出: WARNING/ERROR 是否输出到标准错误、是否添加颜色、是否使用非阻塞写入以及缓冲区大小。
+    // 可以随时调用，在控制台输出线程写入下一条日志时生效。
+    static void setConsoleOptions(const ConsoleOptions& options);
+
+    // 设置文件索引: 在日志文件旁增量维护 <file_name>.idx, 记录每个块的偏移、时间范围与日志等级，见 fileindex.hpp.
+    // 可以随时调用，在文件输出线程写入下一条日志时生效。
+    static void setFileIndex(const FileIndexOptions& options = FileIndexOptions());
+
+    // 阻塞直到调用前提交的所有日志都已写入控制台与文件。不能在日志的格式化参数中调用。
+    static void flush();
+
+#ifdef MYLOGGER_HAS_COROUTINES
+    // C++20 协程接口，见 awaitable.hpp. co_await flushAsync() 在调用前提交的日志全部输出后恢复协程;
+    // co_await infoAsync() 等在格式化队列已满时挂起协程，腾出空间后再提交日志。参数会被拷贝。
+    static FlushAwaitable flushAsync();
+
+    template <typename... Args>
+    static auto debugAsync(const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static auto infoAsync(const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static auto warningAsync(const std::string& message, const Args&... args);
+
+    template <typename... Args>
+    static auto errorAsync(const std::string& message, const Args&... args);
+
+    // 设置挂起的协程的恢复方式，例如投递到协程所在的执行器。为空时在后台线程中直接恢复。
+    static void setAsyncResumer(std::function<void(std::coroutine_handle<>)> resumer);
+#endif // MYLOGGER_HAS_COROUTINES
+
+    // 启动运行时控制通道(仅 Linux): 监听本地 Unix 域套接字 socket_path, 并/或监视配置文件 config_file,
+    // 收到命令后通过 setLevel() 等接口修改配置。参数为空表示不启用对应的通道。命令格式见 controller.hpp.
+    static void startControl(const std::string& socket_path, const std::string& config_file = "");
+
+    // 多进程共享日志(仅 Linux)，见 sharedsink.hpp. 在收集进程中创建 capacity 字节的共享缓冲区并启动收集线程,
+    // 之后 fork 出的子进程输出到文件的日志都写入共享缓冲区，由收集进程写入文件。只能调用一次。
+    static void startSharedCollector(const std::string& shm_name, std::size_t capacity = 4 * 1024 * 1024);
+
+    // 以生产者身份连接已存在的共享缓冲区，之后本进程输出到文件的日志都交给收集进程写入
+    static void attachSharedSink(const std::string& shm_name);
+
+    // 获取日志库的运行统计快照。各项计数分散在各个线程中，仅在调用时汇总。
+    static LoggerStats stats();
+
+    // 将运行统计以 Prometheus 文本格式写入文件(先写入临时文件再重命名，读取方不会读到不完整的内容)
+    static void dumpStats(const std::string& file_name);
+
+    // 启用飞行记录器: 每条日志(包括被日志等级、采样过滤掉的日志)都写入每个线程的内存环形缓冲区,
+    // 出现 ERROR 或崩溃时转储到磁盘。只能调用一次，否则抛出 std::runtime_error. 详见 flightrecorder.hpp.
+    static void enableFlightRecorder(const FlightRecorderOptions& options = FlightRecorderOptions());
+
+    // 将飞行记录器中的日志按时间顺序解码为文本写入文件。未启用飞行记录器时抛出 std::runtime_error.
+    static void dumpFlightRecorder(const std::string& file_name);
+
+    static unsigned long long rateLimitedCount();  // 被限流丢弃的日志总数
+    static unsigned long long deduplicatedCount(); // 被折叠的重复日志总数
 };
 
+template <unsigned int Sinks, bool Sampling, typename... Args>
+void Logger::submit(LogLevel level, const std::string& message, const Args&... args) {
+    FlightRecorder::record(level, message, args...);
+
+    // 持有配置直到格式化任务入队，之后由格式化队列保证它在任务执行完之前不被释放
+    ConfigPin pin;
+    const Config* config = pin.get();
+    if (!accepted(*config, level, Sinks, Sampling))
+        return;
+
+    // 由于 Formatter 在实例化的时候会获取线程id，所以这里不能在线程池中实例化，只能在主线程中实例化，然后在线程池中传入参数
+    // Formatter 从对象池中取出，在格式化线程中用完后马上归还
+    Formatter* formatter = FormatterPool::getFormatterPool().acquire(level);
+
+    // 可调用对象参数在通过检查之后才求值，格式化任务中保存的是求值结果
+    // WARNING 及以上的日志进入优先通道，同一线程的日志仍按提交的顺序输出
+    ThreadsPool& pool = ThreadsPool::getThreadsPool();
+    formatter->m_producer = ThreadsPool::producerId();
+    ProducerCounters::local().m_enqueued.add();
+    pool.addFormatTask(
+        pool.laneOf(level), formatter->m_producer,
+        [=](const typename LazyArg<Args>::Type... args) {
+            formatter->parseFormatString(message, args...);
+            output(formatter, (Sinks & kConsole) && config->console_output_enabled,
+                   (Sinks & kFile) && config->file_output_enabled, *config);
+        },
+        LazyArg<Args>::resolve(args)...);
+}
+
+template <unsigned int Sinks, typename... Args>
+void Logger::submit(CallSite& site, LogLevel level, const std::string& message, const Args&... args) {
+    if (!admit(site, level, Sinks))
+        return;
+
+    // 供 Formatter 记录源码位置，汇总信息同样属于该调用点。可调用对象参数抛出异常时同样会恢复
+    CallSite::Scope scope(&site.m_location);
+    submit<Sinks>(level, message, args...);
+
+    // 之后没有日志从该调用点通过时，由格式化线程的定时任务输出
+    unsigned long long suppressed = site.takeSuppressed();
+    if (suppressed > 0)
+        reportSuppressed(site, level, Sinks, suppressed);
+}
+
+template <typename... Args>
+void Logger::debug(const std::string& message, const Args&... args) {
+    submit<kAllSinks>(LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::info(const std::string& message, const Args&... args) {
+    submit<kAllSinks>(LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warning(const std::string& message, const Args&... args) {
+    submit<kAllSinks>(LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::error(const std::string& message, const Args&... args) {
+    submit<kAllSinks>(LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::log(LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kAllSinks>(level, message, args...);
+}
+
+template <typename... Args>
+void Logger::debug(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kAllSinks>(site, LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::info(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kAllSinks>(site, LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warning(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kAllSinks>(site, LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::error(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kAllSinks>(site, LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::log(CallSite& site, LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kAllSinks>(site, level, message, args...);
+}
+
+template <typename... Args>
+void Logger::debugc(const std::string& message, const Args&... args) {
+    submit<kConsole>(LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::infoc(const std::string& message, const Args&... args) {
+    submit<kConsole>(LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warningc(const std::string& message, const Args&... args) {
+    submit<kConsole>(LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::errorc(const std::string& message, const Args&... args) {
+    submit<kConsole>(LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::logc(LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kConsole>(level, message, args...);
+}
+
+template <typename... Args>
+void Logger::debugc(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kConsole>(site, LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::infoc(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kConsole>(site, LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warningc(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kConsole>(site, LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::errorc(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kConsole>(site, LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::logc(CallSite& site, LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kConsole>(site, level, message, args...);
+}
+
+template <typename... Args>
+void Logger::debugf(const std::string& message, const Args&... args) {
+    submit<kFile>(LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::infof(const std::string& message, const Args&... args) {
+    submit<kFile>(LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warningf(const std::string& message, const Args&... args) {
+    submit<kFile>(LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::errorf(const std::string& message, const Args&... args) {
+    submit<kFile>(LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::logf(LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kFile>(level, message, args...);
+}
+
+template <typename... Args>
+void Logger::debugf(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kFile>(site, LogLevel::DEBUG, message, args...);
+}
+
+template <typename... Args>
+void Logger::infof(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kFile>(site, LogLevel::INFO, message, args...);
+}
+
+template <typename... Args>
+void Logger::warningf(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kFile>(site, LogLevel::WARNING, message, args...);
+}
+
+template <typename... Args>
+void Logger::errorf(CallSite& site, const std::string& message, const Args&... args) {
+    submit<kFile>(site, LogLevel::ERROR, message, args...);
+}
+
+template <typename... Args>
+void Logger::logf(CallSite& site, LogLevel level, const std::string& message, const Args&... args) {
+    if (level <= LogLevel::ERROR)
+        submit<kFile>(site, level, message, args...);
+}
+
+template <typename... Args>
+void Logger::blob(LogLevel level, BlobFormat format, const void* data, std::size_t size, const std::string& message,
+                  const Args&... args) {
+    if (level > LogLevel::ERROR)
+        return;
+    FlightRecorder::record(level, message, args...);
+
+    ConfigPin pin;
+    const Config* config = pin.get();
+    if (!accepted(*config, level, kAllSinks))
+        return;
+
+    // 数据只在这里拷贝一次，格式化任务与各个输出任务共享同一份
+    std::shared_ptr<const Blob> payload(new Blob(data, size, format));
+    Formatter* formatter = FormatterPool::getFormatterPool().acquire(level);
+
+    ThreadsPool& pool = ThreadsPool::getThreadsPool();
+    formatter->m_producer = ThreadsPool::producerId();
+    ProducerCounters::local().m_enqueued.add();
+    pool.addFormatTask(
+        pool.laneOf(level), formatter->m_producer,
+        [=](const typename LazyArg<Args>::Type... args) {
+            formatter->parseFormatString(message, args...);
+            outputBlob(formatter, payload, config->console_output_enabled, config->file_output_enabled, *config);
+        },
+        LazyArg<Args>::resolve(args)...);
+}
+
+template <typename... Args>
+void Logger::hexdump(LogLevel level, const void* data, std::size_t size, const std::string& message,
+                     const Args&... args) {
+    blob(level, BlobFormat::HEXDUMP, data, size, message, args...);
+}
+
+template <typename Func>
+DeferredArg<std::decay_t<Func>> Logger::deferred(Func&& callable) {
+    static_assert(!std::is_void_v<std::invoke_result_t<const std::decay_t<Func>&>>,
+                  "Logger::deferred() requires a callable that returns a value.");
+    return DeferredArg<std::decay_t<Func>>{std::forward<Func>(callable)};
+}
+
+#ifdef MYLOGGER_HAS_COROUTINES
+inline FlushAwaitable Logger::flushAsync() {
+    return FlushAwaitable(&Logger::postFlush);
+}
+
+template <typename... Args>
+auto Logger::debugAsync(const std::string& message, const Args&... args) {
+    auto submit = [message, args...] { debug(message, args...); };
+    bool enabled = ConfigPin().get()->level <= LogLevel::DEBUG;
+    return LogAwaitable<decltype(submit)>(enabled, std::move(submit));
+}
+
+template <typename... Args>
+auto Logger::infoAsync(const std::string& message, const Args&... args) {
+    auto submit = [message, args...] { info(message, args...); };
+    bool enabled = ConfigPin().get()->level <= LogLevel::INFO;
+    return LogAwaitable<decltype(submit)>(enabled, std::move(submit));
+}
+
+template <typename... Args>
+auto Logger::warningAsync(const std::string& message, const Args&... args) {
+    auto submit = [message, args...] { warning(message, args...); };
+    bool enabled = ConfigPin().get()->level <= LogLevel::WARNING;
+    return LogAwaitable<decltype(submit)>(enabled, std::move(submit));
+}
+
+template <typename... Args>
+auto Logger::errorAsync(const std::string& message, const Args&... args) {
+    auto submit = [message, args...] { error(message, args...); };
+    return LogAwaitable<decltype(submit)>(true, std::move(submit));
+}
+
+inline void Logger::setAsyncResumer(std::function<void(std::coroutine_handle<>)> resumer) {
+    AsyncResumer::set(std::move(resumer));
+}
+#endif // MYLOGGER_HAS_COROUTINES
+
+#ifdef MYLOGGER_HEADER_ONLY
 #ifndef MYLOGGER_LOGGER_INL_HPP
 #include "logger-inl.hpp"
 MYLOGGER_LOGGER_INL_HPP // 调用一下 logger-inl.hpp 里定义的宏, 避免编译器警告
 #endif                  // MYLOGGER_LOGGER_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
 
 #endif // MYLOGGER_LOGGER_HPP
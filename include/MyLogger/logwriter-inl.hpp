@@ -9,47 +9,256 @@
 #include "logwriter.hpp"
 #endif // MYLOGGER_LOGWRITER_HPP
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
 #include <fstream>
-#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+
+#include "threadspool.hpp"
 
 // inline LogWriter& LogWriter::getLogWriter() {
 //     static LogWriter logWritter;
 //     return logWritter;
 // }
 
-inline std::string LogWriter::removeEscapeChar(const std::string& message) {
+MYLOGGER_INLINE std::string LogWriter::removeEscapeChar(const std::string& message) {
     std::string result;
     result.reserve(message.size());
+    appendWithoutEscapeChar(result, message);
+    return result;
+}
+
+MYLOGGER_INLINE void LogWriter::appendWithoutEscapeChar(std::string& out, const std::string& message) {
     std::string::size_type pos_left = 0;
     std::string::size_type pos_right = 0;
     while (pos_right < message.size()) {
-        while (pos_right < message.size()) {
-            if (message[pos_right] == -128) {
-                result.append(message.substr(pos_left, pos_right - pos_left));
-                pos_right++;
-                pos_left = pos_right;
-                break;
+        if (message[pos_right] == -128) {
+            out.append(message, pos_left, pos_right - pos_left);
+            pos_left = pos_right + 1;
+        }
+        pos_right++;
+    }
+    out.append(message, pos_left, std::string::npos);
+}
+
+MYLOGGER_INLINE LogWriter::Metrics& LogWriter::metrics() {
+    static Metrics instance;
+    return instance;
+}
+
+MYLOGGER_INLINE LogWriter::Console::~Console() {
+    if (!options.non_blocking)
+        return;
+    for (int fd : {out.fd, err.fd}) {
+        int flags = fcntl(fd, F_GETFL);
+        if (flags >= 0)
+            fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+}
+
+MYLOGGER_INLINE LogWriter::Console& LogWriter::console() {
+    static Console instance;
+    static const bool registered = (ThreadsPool::addForkLock(instance.mtx), true);
+    (void)registered;
+    return instance;
+}
+
+MYLOGGER_INLINE void LogWriter::setConsoleOptions(const ConsoleOptions& options) {
+    Console& state = console();
+    std::unique_lock<std::mutex> lock(state.mtx);
+    state.new_options = options;
+    state.changed.store(true, std::memory_order_release);
+}
+
+MYLOGGER_INLINE void LogWriter::applyConsoleOptions(Console& state) {
+    // 先按旧参数写出已缓冲的日志
+    flushStream(state.out);
+    flushStream(state.err);
+
+    bool was_non_blocking = state.options.non_blocking;
+    {
+        std::unique_lock<std::mutex> lock(state.mtx);
+        state.options = state.new_options;
+        state.changed.store(false, std::memory_order_relaxed);
+    }
+
+    for (ConsoleStream* stream : {&state.out, &state.err}) {
+        // 输出被重定向到文件或管道时不添加颜色
+        stream->colors = state.options.colors && isatty(stream->fd) == 1;
+        stream->buffer.reserve(state.options.buffer_size);
+
+        // O_NONBLOCK 作用于整个打开的文件描述，会影响共享同一终端或管道的其他进程
+        if (state.options.non_blocking != was_non_blocking) {
+            int flags = fcntl(stream->fd, F_GETFL);
+            if (flags >= 0) {
+                flags = state.options.non_blocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+                fcntl(stream->fd, F_SETFL, flags);
             }
-            pos_right++;
         }
     }
-    if (pos_left != pos_right)
-        result.append(message.substr(pos_left));
-    return result;
 }
 
-inline void LogWriter::writeToConsole(const std::string& message) {
-    std::unique_lock<std::mutex> lock(m_console_mtx);
-    std::cout << removeEscapeChar(message);
+MYLOGGER_INLINE void LogWriter::flushStream(ConsoleStream& stream) {
+    if (stream.buffer.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t written_bytes = 0;
+    std::size_t end = stream.buffer.size(); // 需要写出的范围，写了一半的日志只写到它的结尾
+    bool waiting = false;                           // 是否正在等待写完当前日志
+    std::chrono::steady_clock::time_point deadline; // 等待的截止时间
+    while (written_bytes < end) {
+        ssize_t written = write(stream.fd, stream.buffer.data() + written_bytes, end - written_bytes);
+        if (written > 0) {
+            written_bytes += static_cast<std::size_t>(written);
+            continue;
+        }
+        if (written < 0 && errno == EINTR)
+            continue;
+
+        // EAGAIN(非阻塞模式下管道已满)或其他错误: 丢弃尚未开始写出的日志，不阻塞输出线程
+        auto current = std::upper_bound(stream.ends.begin(), stream.ends.end(), written_bytes);
+        std::size_t current_begin = current == stream.ends.begin() ? 0 : *(current - 1);
+        if (written < 0 && errno == EAGAIN && written_bytes > current_begin) {
+            // 已写出当前日志的一部分: 等待 fd 可写，写完这条日志为止
+            auto now = std::chrono::steady_clock::now();
+            if (!waiting) {
+                waiting = true;
+                end = *current;
+                deadline = now + kPartialLineTimeout;
+            }
+            auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            pollfd pfd{stream.fd, POLLOUT, 0};
+            if (timeout > 0 && poll(&pfd, 1, static_cast<int>(timeout)) > 0)
+                continue;
+        }
+        break;
+    }
+
+    // 结束位置不超过已写出字节数的日志均已完整写出; 写了一半的日志保留剩余部分，其余未写出的日志丢弃
+    std::size_t complete =
+        std::upper_bound(stream.ends.begin(), stream.ends.end(), written_bytes) - stream.ends.begin();
+    std::size_t current_begin = complete > 0 ? stream.ends[complete - 1] : 0;
+    bool torn = complete < stream.ends.size() && written_bytes > current_begin;
+
+    Metrics& m = metrics();
+    m.console_written.add(complete);
+    m.console_dropped.add(stream.ends.size() - complete - (torn ? 1 : 0));
+    m.console_bytes.add(written_bytes);
+    m.console_write_time.record(std::chrono::steady_clock::now() - start);
+
+    if (torn) {
+        stream.buffer.erase(stream.ends[complete]);
+        stream.buffer.erase(0, written_bytes);
+        stream.ends.assign(1, stream.buffer.size());
+    } else {
+        stream.buffer.clear();
+        stream.ends.clear();
+    }
+}
+
+MYLOGGER_INLINE void LogWriter::writeToConsole(LogLevel level, const std::string& message) {
+    appendToConsole(level, message, nullptr);
 }
 
-inline void LogWriter::writeToFile(const std::string& filePath, const std::string& message) {
-    std::unique_lock<std::mutex> lock(m_file_mtx);
-    std::ofstream file(filePath, std::ios::app);
-    if (file.is_open()) {
-        file << removeEscapeChar(message);
+MYLOGGER_INLINE void LogWriter::writeBlobToConsole(LogLevel level, const std::string& header,
+                                                   const std::shared_ptr<const Blob>& blob) {
+    appendToConsole(level, header, blob.get());
+}
+
+MYLOGGER_INLINE void LogWriter::appendToConsole(LogLevel level, const std::string& message, const Blob* blob) {
+    Console& state = console();
+    if (state.changed.load(std::memory_order_acquire))
+        applyConsoleOptions(state);
+
+    bool to_stderr = state.options.warnings_to_stderr && level >= LogLevel::WARNING;
+    ConsoleStream& stream = to_stderr ? state.err : state.out;
+
+    // 切换输出流时先写出另一个流中的日志，保证两者交替输出到同一终端时的先后顺序
+    if (state.last != &stream && state.last != nullptr)
+        flushStream(*state.last);
+    state.last = &stream;
+
+    if (stream.colors) {
+        static const char* const kColors[] = {"\033[36m", "\033[32m", "\033[33m", "\033[31m"};
+        stream.buffer += kColors[static_cast<int>(level)];
+    }
+    appendWithoutEscapeChar(stream.buffer, message);
+    if (stream.colors) {
+        // 颜色在换行符之前结束，避免影响下一行
+        bool newline = !stream.buffer.empty() && stream.buffer.back() == '\n';
+        if (newline)
+            stream.buffer.pop_back();
+        stream.buffer += "\033[0m";
+        if (newline)
+            stream.buffer += '\n';
+    }
+    // 二进制数据不添加颜色，直接编码到缓冲区中
+    if (blob)
+        blob->appendTo(stream.buffer);
+    stream.ends.push_back(stream.buffer.size());
+
+    if (stream.buffer.size() >= state.options.buffer_size)
+        flushStream(stream);
+}
+
+MYLOGGER_INLINE void LogWriter::flushConsole() {
+    Console& state = console();
+    flushStream(state.out);
+    flushStream(state.err);
+}
+
+MYLOGGER_INLINE void LogWriter::writeToFile(const std::string& filePath, LogLevel level,
+                                            std::chrono::system_clock::time_point time, const std::string& message) {
+    appendToFile(filePath, message, nullptr, true, level, time);
+}
+
+MYLOGGER_INLINE void LogWriter::writeBlobToFile(const std::string& filePath, LogLevel level,
+                                                std::chrono::system_clock::time_point time, const std::string& header,
+                                                const std::shared_ptr<const Blob>& blob) {
+    appendToFile(filePath, header, blob.get(), true, level, time);
+}
+
+MYLOGGER_INLINE void LogWriter::writeBatchToFile(const std::string& filePath, const std::string& batch) {
+    appendToFile(filePath, batch, nullptr, false, LogLevel::DEBUG, std::chrono::system_clock::time_point());
+}
+
+MYLOGGER_INLINE void LogWriter::appendToFile(const std::string& filePath, const std::string& message,
+                                             const Blob* blob, bool indexed, LogLevel level,
+                                             std::chrono::system_clock::time_point time) {
+    auto start = std::chrono::steady_clock::now();
+    // 输出缓冲区在线程内复用(文件输出线程与共享收集线程各一个)，不为每条日志重新分配
+    static thread_local std::string output;
+    output.clear();
+    output.reserve(message.size() + (blob ? blob->encodedSize() : 0));
+    appendWithoutEscapeChar(output, message);
+    if (blob)
+        blob->appendTo(output);
+    {
+        std::unique_lock<std::mutex> lock(m_file_mtx);
+        std::ofstream file(filePath, std::ios::app);
+        if (!file.is_open())
+            return;
+        // 以追加方式打开时写入位置总是文件末尾，索引需要先取得写入前的文件大小
+        indexed = indexed && FileIndex::enabled();
+        std::streamoff offset = indexed ? static_cast<std::streamoff>(file.seekp(0, std::ios::end).tellp()) : 0;
+        file << output;
         file.close();
+        if (indexed && offset >= 0)
+            FileIndex::record(filePath, static_cast<std::uint64_t>(offset), output.size(), level, time);
     }
+
+    Metrics& m = metrics();
+    m.file_written.add();
+    m.file_bytes.add(output.size());
+    m.file_write_time.record(std::chrono::steady_clock::now() - start);
+
+    // 一次大的写入(如二进制数据)之后释放多余的容量
+    if (output.capacity() > kMaxRetainedBuffer)
+        std::string().swap(output);
 }
 
 #endif // MYLOGGER_LOGWRITER_INL_HPP
@@ -5,15 +5,35 @@
 #ifndef MYLOGGER_LOGWRITER_HPP
 #define MYLOGGER_LOGWRITER_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
+
+#include "blob.hpp"
+#include "common.hpp"
+#include "fileindex.hpp"
+#include "loglevel.hpp"
+#include "stats.hpp"
 
-static std::mutex m_console_mtx;
 static std::mutex m_file_mtx;
 
+// 控制台输出的参数，通过 Logger::setConsoleOptions() 设置
+struct ConsoleOptions {
+    bool warnings_to_stderr = false;     // WARNING/ERROR 日志输出到标准错误，其余输出到标准输出
+    bool colors = false;                 // 输出目标为终端(isatty)时按日志等级添加 ANSI 颜色，默认关闭
+    bool non_blocking = false;           // 将标准输出/标准错误设为 O_NONBLOCK, 写入会阻塞时丢弃日志而不是等待
+    std::size_t buffer_size = 64 * 1024; // 缓冲区达到该大小或输出队列为空时执行一次 write()
+};
+
 class LogWriter {
   private:
     friend class Logger;
+    friend class ThreadsPool;
+    friend class SharedSink;
 
   private:
     LogWriter() = default;
@@ -22,18 +42,104 @@ class LogWriter {
     LogWriter& operator=(const LogWriter&) = delete;
     // static LogWriter& getLogWriter();
 
+  private:
+    static constexpr std::size_t kMaxRetainedBuffer = 1024 * 1024; // 文件输出缓冲区保留的最大容量
+    // 非阻塞模式下一条日志只写出一部分时，为写完这条日志最多等待的时间
+    static constexpr std::chrono::milliseconds kPartialLineTimeout{100};
+
+    // 输出线程的运行统计，均只由对应的输出线程写入
+    struct Metrics {
+        Counter console_written;
+        Counter console_bytes;
+        Counter console_dropped;
+        Histogram console_write_time;
+        Counter file_written;
+        Counter file_bytes;
+        Histogram file_write_time;
+    };
+
+    static Metrics& metrics();
+
+  private:
+    // 控制台的一个输出流(标准输出或标准错误)，由控制台输出线程独占
+    struct ConsoleStream {
+        int fd;
+        bool colors = false;           // 是否添加 ANSI 颜色
+        std::string buffer;            // 尚未写入的日志
+        std::vector<std::size_t> ends; // buffer 中每条日志的结束位置，size() 即日志条数
+    };
+
+    struct Console {
+        ConsoleOptions options;
+        ConsoleStream out{1, false, std::string(), {}};
+        ConsoleStream err{2, false, std::string(), {}};
+        ConsoleStream* last = nullptr; // 上一条日志写入的输出流
+
+        // Logger::setConsoleOptions() 设置的新参数，由控制台输出线程在下一次写入时应用
+        std::mutex mtx;
+        ConsoleOptions new_options;
+        std::atomic<bool> changed{true};
+
+        // 恢复被设置为非阻塞的 fd, 避免影响共享终端或管道的父进程
+        ~Console();
+    };
+
+    static Console& console();
+
+    // 在控制台输出线程中应用新参数
+    static void applyConsoleOptions(Console& state);
+
+    // 将 stream 的缓冲区一次性写入对应的 fd. 非阻塞模式下写入会阻塞时丢弃尚未开始写出的日志;
+    // 一条日志只写出一部分时先等待(最多 kPartialLineTimeout)写完这条日志，避免输出半行日志。
+    // 超时后剩余部分留在缓冲区中，下次写入时最先写出。
+    static void flushStream(ConsoleStream& stream);
+
   private:
     // 删除转义字符
     static std::string removeEscapeChar(const std::string& message);
 
+    // 删除转义字符，并将结果追加到 out 中
+    static void appendWithoutEscapeChar(std::string& out, const std::string& message);
+
+  private:
+    // 设置控制台输出的参数，可以在任意线程调用
+    static void setConsoleOptions(const ConsoleOptions& options);
+
+    // 将日志追加到缓冲区中，缓冲区已满时写入。仅由控制台输出线程调用。
+    static void writeToConsole(LogLevel level, const std::string& message);
+
+    // 同 writeToConsole(), 在 header 之后追加 blob 的编码结果
+    static void writeBlobToConsole(LogLevel level, const std::string& header, const std::shared_ptr<const Blob>& blob);
+
+    // 写入所有缓冲的控制台日志。仅由控制台输出线程调用。
+    static void flushConsole();
+
+    // 将一条日志写入文件。level 与 time 用于文件索引。仅由文件输出线程调用。
+    static void writeToFile(const std::string& filePath, LogLevel level, std::chrono::system_clock::time_point time,
+                            const std::string& message);
+
+    // 同 writeToFile(), 在 header 之后追加 blob 的编码结果
+    static void writeBlobToFile(const std::string& filePath, LogLevel level,
+                                std::chrono::system_clock::time_point time, const std::string& header,
+                                const std::shared_ptr<const Blob>& blob);
+
+    // 将多条日志一次写入文件，不记入文件索引。用于共享收集进程。
+    static void writeBatchToFile(const std::string& filePath, const std::string& batch);
+
   private:
-    static void writeToConsole(const std::string& message);
-    static void writeToFile(const std::string& filePath, const std::string& message);
+    // 删除 message 中的转义字符后追加到输出缓冲区，blob 不为空时将其编码结果直接追加在之后
+    static void appendToConsole(LogLevel level, const std::string& message, const Blob* blob);
+
+    // indexed 为 true 且启用了文件索引时，将写入的日志记入索引
+    static void appendToFile(const std::string& filePath, const std::string& message, const Blob* blob, bool indexed,
+                             LogLevel level, std::chrono::system_clock::time_point time);
 };
 
+#ifdef MYLOGGER_HEADER_ONLY
 #ifndef MYLOGGER_LOGWRITER_INL_HPP
 #include "logwriter-inl.hpp"
 MYLOGGER_LOGWRITER_INL_HPP
 #endif
+#endif // MYLOGGER_HEADER_ONLY
 
 #endif // MYLOGGER_LOGWRITER_HPP
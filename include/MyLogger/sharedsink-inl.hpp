@@ -0,0 +1,428 @@
+// sharedsink 类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_SHAREDSINK_INL_HPP
+#define MYLOGGER_SHAREDSINK_INL_HPP
+
+#ifndef MYLOGGER_SHAREDSINK_HPP
+#include "sharedsink.hpp"
+#endif // MYLOGGER_SHAREDSINK_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "logwriter.hpp"
+
+MYLOGGER_INLINE SharedSink::SharedSink()
+    : m_region(nullptr), m_region_size(0), m_collector(false), m_stop(false), m_pid(0), m_intent(-1),
+      m_stall_read(0) {
+    // 收集线程使用的静态对象先于 SharedSink 构造完成，从而在收集线程退出之后才析构
+    LogWriter::metrics();
+}
+
+MYLOGGER_INLINE SharedSink::~SharedSink() {
+    if (!m_collector) {
+        // 生产者的格式化线程可能仍在写入，保留映射直到进程退出; 之后的日志直接写入文件
+        producer().store(nullptr, std::memory_order_release);
+        return;
+    }
+
+    m_stop.store(true, std::memory_order_release);
+    Header* h = header();
+    h->wakeups.fetch_add(1, std::memory_order_release);
+    futexWake(h->wakeups);
+    if (m_thread.joinable())
+        m_thread.join();
+#ifdef __linux__
+    shm_unlink(m_name.c_str());
+#endif
+}
+
+MYLOGGER_INLINE SharedSink& SharedSink::getSharedSink() {
+    static SharedSink instance;
+    return instance;
+}
+
+MYLOGGER_INLINE std::atomic<SharedSink*>& SharedSink::producer() {
+    static std::atomic<SharedSink*> sink(nullptr);
+    return sink;
+}
+
+MYLOGGER_INLINE SharedSink::Header* SharedSink::header() const {
+    return reinterpret_cast<Header*>(m_region);
+}
+
+MYLOGGER_INLINE char* SharedSink::data() const {
+    return m_region + sizeof(Header);
+}
+
+MYLOGGER_INLINE std::uint64_t SharedSink::dropped() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    return m_region ? header()->dropped.load(std::memory_order_relaxed) : 0;
+}
+
+MYLOGGER_INLINE char* SharedSink::mapRegion(const std::string& name, std::size_t& size, bool create) {
+#ifdef __linux__
+    int fd = shm_open(name.c_str(), create ? O_CREAT | O_RDWR | O_CLOEXEC : O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open shared memory " + name + ": " + std::strerror(errno) + ".");
+    }
+
+    int error = 0;
+    struct stat st;
+    if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        error = errno;
+    } else if (!create) {
+        if (fstat(fd, &st) == 0)
+            size = static_cast<std::size_t>(st.st_size);
+        else
+            error = errno;
+    }
+    void* region = error == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (error == 0 && region == MAP_FAILED)
+        error = errno;
+    close(fd);
+    if (error != 0) {
+        throw std::runtime_error("Failed to map shared memory " + name + ": " + std::strerror(error) + ".");
+    }
+    return static_cast<char*>(region);
+#else
+    (void)size;
+    (void)create;
+    throw std::runtime_error("Shared memory sink is only supported on Linux: " + name + ".");
+#endif
+}
+
+MYLOGGER_INLINE void SharedSink::start(const std::string& name, std::size_t capacity) {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (m_region) {
+        throw std::runtime_error("Shared sink has already been started.");
+    }
+    if (capacity < 64 * 1024) {
+        throw std::runtime_error("Shared sink capacity must be at least 64 KiB.");
+    }
+
+    capacity = (capacity + kAlign - 1) / kAlign * kAlign;
+    std::size_t size = sizeof(Header) + capacity;
+    char* region = mapRegion(name, size, true);
+
+    // 同名共享内存中可能残留上一次运行的内容，全部清空后重新初始化
+    std::memset(region, 0, size);
+    Header* h = new (region) Header();
+    std::memcpy(h->magic, "MYLOGSQ2", sizeof(h->magic));
+    h->capacity = capacity;
+
+    m_name = name;
+    m_region = region;
+    m_region_size = size;
+    m_collector = true;
+    m_thread = std::thread([this] { collect(); });
+
+#ifdef __linux__
+    static const bool registered = pthread_atfork(nullptr, nullptr, childAfterFork) == 0;
+    (void)registered;
+#endif
+}
+
+MYLOGGER_INLINE void SharedSink::attach(const std::string& name) {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (m_region) {
+        throw std::runtime_error("Shared sink has already been started.");
+    }
+
+    std::size_t size = 0;
+    char* region = mapRegion(name, size, false);
+    const Header* h = reinterpret_cast<const Header*>(region);
+    if (size < sizeof(Header) || std::memcmp(h->magic, "MYLOGSQ2", sizeof(h->magic)) != 0 ||
+        h->capacity != size - sizeof(Header)) {
+#ifdef __linux__
+        munmap(region, size);
+#endif
+        throw std::runtime_error("Invalid shared sink: " + name + ".");
+    }
+
+    m_name = name;
+    m_region = region;
+    m_region_size = size;
+    claimIntent();
+    producer().store(this, std::memory_order_release);
+
+#ifdef __linux__
+    static const bool registered = pthread_atfork(nullptr, nullptr, childAfterFork) == 0;
+    (void)registered;
+#endif
+}
+
+MYLOGGER_INLINE bool SharedSink::push(const std::string& file_name, const std::string& message) {
+    Header* h = header();
+    std::uint64_t capacity = h->capacity;
+    std::size_t payload_size = file_name.size() + 1 + message.size();
+    std::uint64_t size = (sizeof(RecordHeader) + payload_size + kAlign - 1) / kAlign * kAlign;
+    if (size > capacity / 2) {
+        h->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 预留空间: 数据区末尾放不下时连同末尾的剩余部分一起预留，写入一条填充记录。
+    // 每次尝试之前先登记预留意图，在写入记录头之前被终止时收集线程由此得知写入者与记录大小
+    Intent* intent = m_intent >= 0 ? &h->intents[m_intent] : nullptr;
+    std::uint64_t pos = h->reserve.load(std::memory_order_relaxed);
+    std::uint64_t skip;
+    while (true) {
+        std::uint64_t offset = pos % capacity;
+        skip = offset + size > capacity ? capacity - offset : 0;
+        if (pos + skip + size - h->read.load(std::memory_order_acquire) > capacity) {
+            if (intent)
+                intent->pos.store(0, std::memory_order_relaxed);
+            h->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (intent) {
+            intent->length.store(static_cast<std::uint32_t>(skip + size), std::memory_order_relaxed);
+            intent->pos.store(pos + 1, std::memory_order_release);
+        }
+        if (h->reserve.compare_exchange_weak(pos, pos + skip + size, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed))
+            break;
+    }
+
+    // 先发布记录头(与填充记录)，写入内容的过程中被终止时收集线程可以按大小跳过这条记录
+    char* d = data();
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(d + (pos + skip) % capacity);
+    record->size = static_cast<std::uint32_t>(size);
+    record->payload_size = static_cast<std::uint32_t>(payload_size);
+    record->pid = m_pid;
+    record->state.store(kReserved, std::memory_order_release);
+    if (skip != 0) {
+        RecordHeader* padding = reinterpret_cast<RecordHeader*>(d + pos % capacity);
+        padding->size = static_cast<std::uint32_t>(skip);
+        padding->payload_size = 0;
+        padding->pid = m_pid;
+        padding->state.store(kPadding, std::memory_order_release);
+    }
+    if (intent)
+        intent->pos.store(0, std::memory_order_release);
+    char* payload = reinterpret_cast<char*>(record + 1);
+    std::memcpy(payload, file_name.data(), file_name.size());
+    payload[file_name.size()] = '\0';
+    std::memcpy(payload + file_name.size() + 1, message.data(), message.size());
+    record->state.store(kCommitted, std::memory_order_release);
+
+    // 仅在收集线程休眠时才唤醒，与 ThreadsPool 相同
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (h->consumer_waiting.load(std::memory_order_relaxed)) {
+        h->wakeups.fetch_add(1, std::memory_order_release);
+        futexWake(h->wakeups);
+    }
+    return true;
+}
+
+MYLOGGER_INLINE bool SharedSink::drain() {
+    Header* h = header();
+    char* d = data();
+    std::uint64_t capacity = h->capacity;
+    std::uint64_t read = h->read.load(std::memory_order_relaxed);
+    std::uint64_t reserve = h->reserve.load(std::memory_order_acquire);
+
+    // 连续写入同一文件的日志合并为一次写入
+    std::string file_name;
+    std::string batch;
+    bool drained = false;
+    auto write = [&] {
+        if (!batch.empty()) {
+            LogWriter::writeBatchToFile(file_name, batch);
+            batch.clear();
+        }
+    };
+
+    while (batch.size() < kMaxBatch) {
+        // 只解析已预留的位置: reserve 之后的空间可能是上一圈记录内容中的任意字节
+        if (read == reserve) {
+            reserve = h->reserve.load(std::memory_order_acquire);
+            if (read == reserve)
+                break;
+        }
+        RecordHeader* record = reinterpret_cast<RecordHeader*>(d + read % capacity);
+        std::uint32_t state = record->state.load(std::memory_order_acquire);
+        if (state == kEmpty || state == kReserved) {
+            if (!skipStalled(state, read))
+                break;
+            drained = true;
+            continue;
+        }
+
+        std::uint32_t size = record->size;
+        if (state == kCommitted) {
+            const char* payload = reinterpret_cast<const char*>(record + 1);
+            std::size_t name_size = strnlen(payload, record->payload_size);
+            if (file_name.compare(0, std::string::npos, payload, name_size) != 0) {
+                write();
+                file_name.assign(payload, name_size);
+            }
+            if (name_size < record->payload_size)
+                batch.append(payload + name_size + 1, record->payload_size - name_size - 1);
+        }
+
+        // 先将整条记录清零再推进 read, 生产者看到新的 read 时这段空间必然已可以复用，且其中没有残留的记录头
+        std::memset(static_cast<void*>(record), 0, size);
+        read += size;
+        h->read.store(read, std::memory_order_release);
+        drained = true;
+    }
+
+    write();
+    return drained;
+}
+
+MYLOGGER_INLINE bool SharedSink::skipStalled(std::uint32_t state, std::uint64_t& read) {
+    Header* h = header();
+    char* d = data();
+    std::uint64_t capacity = h->capacity;
+
+    // 在同一位置第一次停下时记录开始时间，通常生产者很快就会提交; 停顿超过 kStallCheck 才检查写入者
+    auto now = std::chrono::steady_clock::now();
+    if (m_stall_read != read || m_stall_since == std::chrono::steady_clock::time_point()) {
+        m_stall_read = read;
+        m_stall_since = now;
+    }
+    if (now - m_stall_since < kStallCheck)
+        return false;
+
+    // 记录头已写入时由其中的进程ID与大小确定; 否则查找在 read 处登记了预留意图的进程。
+    // 登记了同一位置的进程中包括尝试预留失败后尚未更新意图的进程，它们都已退出且大小一致时才能确定。
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(d + read % capacity);
+    std::uint64_t length = 0;
+    if (state == kReserved) {
+        if (!processGone(record->pid))
+            return false;
+        length = record->size;
+    } else {
+        for (Intent& intent : h->intents) {
+            if (intent.pos.load(std::memory_order_acquire) != read + 1)
+                continue;
+            std::uint32_t candidate = intent.length.load(std::memory_order_relaxed);
+            if (!processGone(intent.pid.load(std::memory_order_relaxed)) || (length != 0 && length != candidate))
+                return false;
+            length = candidate;
+        }
+        if (length == 0)
+            return false;
+    }
+
+    // 写入者已退出，不会再写入这段空间: 清零后跳过，并清除它们登记的意图
+    for (Intent& intent : h->intents) {
+        if (intent.pos.load(std::memory_order_relaxed) == read + 1)
+            intent.pos.store(0, std::memory_order_relaxed);
+    }
+    std::size_t offset = static_cast<std::size_t>(read % capacity);
+    std::size_t size = static_cast<std::size_t>(length);
+    std::size_t first = std::min<std::size_t>(size, static_cast<std::size_t>(capacity) - offset);
+    std::memset(d + offset, 0, first);
+    std::memset(d, 0, size - first);
+
+    h->dropped.fetch_add(1, std::memory_order_relaxed);
+    read += length;
+    h->read.store(read, std::memory_order_release);
+    m_stall_since = std::chrono::steady_clock::time_point();
+    return true;
+}
+
+MYLOGGER_INLINE void SharedSink::claimIntent() {
+#ifdef __linux__
+    m_pid = static_cast<int>(getpid());
+#endif
+    m_intent = -1;
+    Header* h = header();
+    for (std::size_t i = 0; i < kMaxProducers; i++) {
+        // 已退出的进程仍登记着预留意图时保留其槽位，收集线程跳过它的记录时需要
+        Intent& intent = h->intents[i];
+        std::int32_t pid = intent.pid.load(std::memory_order_relaxed);
+        if ((pid == 0 || (processGone(pid) && intent.pos.load(std::memory_order_acquire) == 0)) &&
+            intent.pid.compare_exchange_strong(pid, m_pid)) {
+            m_intent = static_cast<int>(i);
+            return;
+        }
+    }
+}
+
+MYLOGGER_INLINE bool SharedSink::processGone(std::int32_t pid) {
+#ifdef __linux__
+    return pid > 0 && kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+#else
+    (void)pid;
+    return false;
+#endif
+}
+
+MYLOGGER_INLINE void SharedSink::collect() {
+    Header* h = header();
+    while (true) {
+        if (drain())
+            continue;
+        if (m_stop.load(std::memory_order_acquire)) {
+            drain();
+            return;
+        }
+
+        // 与生产者的 consumer_waiting 检查配对: 先声明休眠再检查一次，避免错过唤醒; 超时兜底
+        std::uint32_t wakeups = h->wakeups.load(std::memory_order_acquire);
+        h->consumer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!drain() && !m_stop.load(std::memory_order_acquire))
+            futexWait(h->wakeups, wakeups, std::chrono::milliseconds(100));
+        h->consumer_waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+MYLOGGER_INLINE void SharedSink::futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected,
+                                           std::chrono::milliseconds timeout) {
+#ifdef __linux__
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000 * 1000000);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+#else
+    (void)word;
+    (void)expected;
+    std::this_thread::sleep_for(timeout);
+#endif
+}
+
+MYLOGGER_INLINE void SharedSink::futexWake(std::atomic<std::uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+MYLOGGER_INLINE void SharedSink::childAfterFork() {
+    // 收集线程在子进程中不存在: 原位构造空的 std::thread, 子进程改为生产者。生产者 fork 出的子进程同样是生产者
+    SharedSink& sink = getSharedSink();
+    if (!sink.m_region)
+        return;
+    if (sink.m_collector) {
+        new (&sink.m_thread) std::thread();
+        sink.m_collector = false;
+    }
+    // 子进程是新的写入者，不能与父进程共用进程ID与意图槽位
+    sink.claimIntent();
+    producer().store(&sink, std::memory_order_release);
+}
+
+#endif // MYLOGGER_SHAREDSINK_INL_HPP
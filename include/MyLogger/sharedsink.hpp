@@ -0,0 +1,149 @@
+// 多进程共享日志(仅 Linux): 多个工作进程将输出到文件的日志写入 POSIX 共享内存中的多生产者单消费者环形缓冲区,
+// 由一个收集进程取出后写入文件，工作进程不再各自以 O_APPEND 争用同一个文件。
+//
+//     Logger::startSharedCollector("/myapp-log"); // prefork 服务器的主进程，在 fork() 之前调用
+//     fork();                                     // 子进程自动将文件日志写入共享缓冲区
+//     Logger::attachSharedSink("/myapp-log");     // 不是由收集进程 fork 出的进程需要主动连接
+//
+// 控制台输出不受影响。缓冲区已满时丢弃日志并计数(LoggerStats::shared_dropped)。
+//
+// 共享内存的布局为 Header + capacity 字节的数据区。生产者(工作进程的格式化线程)通过 CAS 推进 reserve 预留空间,
+// 写入记录后置位记录头的 state; 消费者按顺序读取 [read, reserve) 中已提交的记录，将整条记录清零后推进 read,
+// 空闲空间因此总是全零，尚未写入记录头的位置读到的必然是 kEmpty. 记录按 kAlign 对齐,
+// 数据区末尾放不下时先写入一条填充记录再从数据区开头写入。
+//
+// 生产者在写入记录的过程中被强制终止时，收集进程停在这条记录上，确认写入者已经退出后按记录大小跳过(计入丢弃的日志条数):
+// 生产者预留空间后立即写入带有进程ID的记录头(kReserved); 在写入记录头之前，生产者在 Header::intents 中登记的
+// 预留位置与大小同样可以找到写入者与记录大小。写入者仍然存在(包括被 SIGSTOP 暂停)时一直等待，不会复用它可能写入的空间。
+// 被终止但尚未被父进程回收(僵尸进程)的写入者在回收之后才会被跳过。
+
+#pragma once
+
+#ifndef MYLOGGER_SHAREDSINK_HPP
+#define MYLOGGER_SHAREDSINK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common.hpp"
+
+class SharedSink {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+
+  private:
+    static constexpr std::size_t kAlign = 16;
+    static constexpr std::uint32_t kEmpty = 0;     // 记录尚未提交或已被消费
+    static constexpr std::uint32_t kCommitted = 1; // 记录已提交
+    static constexpr std::uint32_t kPadding = 2;   // 填充到数据区末尾的空记录
+    static constexpr std::uint32_t kReserved = 3;  // 记录头已写入，正在写入内容
+    static constexpr std::size_t kMaxBatch = 1 << 20; // 收集线程一次最多合并写入的字节数
+    static constexpr std::chrono::milliseconds kStallCheck{100}; // 停在未提交的记录上超过该时间后检查写入者是否存在
+    static constexpr std::size_t kMaxProducers = 256;              // Header::intents 的槽位数
+
+    // 生产者进程登记的预留意图: 尝试预留之前写入，写入记录头之后清除。没有空闲槽位的进程不登记。
+    struct Intent {
+        std::atomic<std::int32_t> pid;     // 占用槽位的进程ID, 0 表示空闲
+        std::atomic<std::uint32_t> length; // 预留的字节数(含填充记录)
+        std::atomic<std::uint64_t> pos;    // 预留的位置 + 1, 0 表示没有进行中的预留
+    };
+
+    struct Header {
+        char magic[8]; // "MYLOGSQ2"
+        std::uint64_t capacity;
+        std::atomic<std::uint64_t> dropped;             // 缓冲区已满时丢弃的日志条数(所有生产者)
+        alignas(64) std::atomic<std::uint64_t> reserve; // 生产者已预留到的位置(累计字节数)
+        alignas(64) std::atomic<std::uint64_t> read;    // 消费者已读取到的位置
+        std::atomic<std::uint32_t> consumer_waiting;    // 消费者正在 futex 上休眠
+        std::atomic<std::uint32_t> wakeups;             // futex 字，唤醒消费者时递增
+        Intent intents[kMaxProducers];
+    };
+
+    struct RecordHeader {
+        std::atomic<std::uint32_t> state; // kEmpty/kCommitted/kPadding/kReserved
+        std::uint32_t size;               // 整条记录的字节数(含记录头，已对齐)
+        std::uint32_t payload_size;       // 文件名 + '\0' + 日志内容的字节数
+        std::int32_t pid;                 // 写入记录的生产者进程ID
+    };
+
+  private:
+    std::mutex m_mtx; // 串行化 start()/attach()
+    std::string m_name;
+    char* m_region;
+    std::size_t m_region_size;
+    bool m_collector;         // 本进程是收集进程
+    std::thread m_thread;     // 收集线程
+    std::atomic<bool> m_stop; // 通知收集线程退出
+    int m_pid;                // 本进程ID, 生产者写入记录头
+    int m_intent;             // 本进程在 Header::intents 中的槽位，-1 表示没有
+
+    // 收集线程停在未提交的记录上的位置与开始时间，只由收集线程访问
+    std::uint64_t m_stall_read;
+    std::chrono::steady_clock::time_point m_stall_since;
+
+  private:
+    SharedSink();
+    ~SharedSink();
+    SharedSink(const SharedSink&) = delete;
+    SharedSink& operator=(const SharedSink&) = delete;
+
+    static SharedSink& getSharedSink();
+
+    // 已连接为生产者的共享缓冲区，未连接时为 nullptr
+    static std::atomic<SharedSink*>& producer();
+
+  private:
+    // 创建共享缓冲区并启动收集线程，之后 fork 出的子进程自动成为生产者。只能调用一次。
+    void start(const std::string& name, std::size_t capacity);
+
+    // 以生产者身份连接已存在的共享缓冲区
+    void attach(const std::string& name);
+
+    // 将一条日志写入共享缓冲区，缓冲区已满时丢弃并返回 false. 可以被多个进程同时调用。
+    bool push(const std::string& file_name, const std::string& message);
+
+    // 收集线程主循环: 取出已提交的记录，按文件名合并后写入文件
+    void collect();
+
+    // 取出当前所有已提交的记录，返回是否取出了记录
+    bool drain();
+
+    // 收集线程停在位置 read 处状态为 state 的未提交记录上: 确认写入者已退出后跳过这条记录并推进 read,
+    // 返回是否跳过
+    bool skipStalled(std::uint32_t state, std::uint64_t& read);
+
+    // 生产者进程占用 Header::intents 中的一个槽位(空闲或属于已退出进程的槽位)，设置 m_pid 与 m_intent
+    void claimIntent();
+
+    // 进程 pid 是否已经退出
+    static bool processGone(std::int32_t pid);
+
+    Header* header() const;
+    char* data() const;
+
+    // 所有生产者因缓冲区已满而丢弃的日志条数，未启用时为 0
+    std::uint64_t dropped();
+
+    // 在共享内存中的 futex 字上等待/唤醒(跨进程，不能使用 FUTEX_PRIVATE_FLAG)
+    static void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected, std::chrono::milliseconds timeout);
+    static void futexWake(std::atomic<std::uint32_t>& word);
+
+    // 打开(create 为 true 时创建并设置为 size 字节)并映射共享内存，返回映射地址，size 为映射的大小
+    static char* mapRegion(const std::string& name, std::size_t& size, bool create);
+    static void childAfterFork();
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_SHAREDSINK_INL_HPP
+#include "sharedsink-inl.hpp"
+MYLOGGER_SHAREDSINK_INL_HPP
+#endif // MYLOGGER_SHAREDSINK_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_SHAREDSINK_HPP
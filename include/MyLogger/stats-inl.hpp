@@ -0,0 +1,128 @@
+// stats 相关类的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_STATS_INL_HPP
+#define MYLOGGER_STATS_INL_HPP
+
+#ifndef MYLOGGER_STATS_HPP
+#include "stats.hpp"
+#endif // MYLOGGER_STATS_HPP
+
+#include <algorithm>
+#include <sstream>
+
+MYLOGGER_INLINE void Histogram::record(std::chrono::nanoseconds elapsed) {
+    unsigned long long ns = elapsed.count() > 0 ? static_cast<unsigned long long>(elapsed.count()) : 0;
+
+    // 桶下标为 ns 的二进制位数
+    std::size_t bucket = 0;
+    while (ns >> bucket && bucket + 1 < HistogramSnapshot::kBuckets) {
+        bucket++;
+    }
+
+    m_buckets[bucket].add();
+    m_count.add();
+    m_sum_ns.add(ns);
+}
+
+MYLOGGER_INLINE HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    for (std::size_t i = 0; i < HistogramSnapshot::kBuckets; i++) {
+        result.buckets[i] = m_buckets[i].get();
+    }
+    result.count = m_count.get();
+    result.sum_ns = m_sum_ns.get();
+    return result;
+}
+
+MYLOGGER_INLINE ProducerCounters::ProducerCounters() {
+    Registry& reg = registry();
+    std::unique_lock<std::mutex> lock(reg.mtx);
+    reg.threads.push_back(this);
+}
+
+MYLOGGER_INLINE ProducerCounters::~ProducerCounters() {
+    Registry& reg = registry();
+    std::unique_lock<std::mutex> lock(reg.mtx);
+    reg.retired_enqueued += m_enqueued.get();
+    reg.retired_sampled_out += m_sampled_out.get();
+    reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+}
+
+MYLOGGER_INLINE ProducerCounters::Registry& ProducerCounters::registry() {
+    static Registry instance;
+    return instance;
+}
+
+MYLOGGER_INLINE ProducerCounters& ProducerCounters::local() {
+    static thread_local ProducerCounters instance;
+    return instance;
+}
+
+MYLOGGER_INLINE void ProducerCounters::collect(LoggerStats& stats) {
+    Registry& reg = registry();
+    std::unique_lock<std::mutex> lock(reg.mtx);
+    stats.enqueued += reg.retired_enqueued;
+    stats.sampled_out += reg.retired_sampled_out;
+    for (const ProducerCounters* counters : reg.threads) {
+        stats.enqueued += counters->m_enqueued.get();
+        stats.sampled_out += counters->m_sampled_out.get();
+    }
+}
+
+MYLOGGER_INLINE std::string LoggerStats::toPrometheus() const {
+    std::ostringstream oss;
+
+    auto counter = [&](const char* name, const char* help, unsigned long long value) {
+        oss << "# HELP mylogger_" << name << " " << help << "\n";
+        oss << "# TYPE mylogger_" << name << " counter\n";
+        oss << "mylogger_" << name << " " << value << "\n";
+    };
+    auto gauge = [&](const char* name, const char* help, unsigned long long value) {
+        oss << "# HELP mylogger_" << name << " " << help << "\n";
+        oss << "# TYPE mylogger_" << name << " gauge\n";
+        oss << "mylogger_" << name << " " << value << "\n";
+    };
+    auto histogram = [&](const char* name, const char* help, const HistogramSnapshot& snapshot) {
+        oss << "# HELP mylogger_" << name << " " << help << "\n";
+        oss << "# TYPE mylogger_" << name << " histogram\n";
+        unsigned long long cumulative = 0;
+        // 最后一个桶没有上界，只计入 +Inf
+        for (std::size_t i = 0; i + 1 < HistogramSnapshot::kBuckets; i++) {
+            cumulative += snapshot.buckets[i];
+            // 第 i 个桶的上界为 2^i - 1 纳秒，换算为秒
+            oss << "mylogger_" << name << "_bucket{le=\"" << ((1ull << i) - 1) / 1e9 << "\"} " << cumulative << "\n";
+        }
+        oss << "mylogger_" << name << "_bucket{le=\"+Inf\"} " << snapshot.count << "\n";
+        oss << "mylogger_" << name << "_sum " << snapshot.sum_ns / 1e9 << "\n";
+        oss << "mylogger_" << name << "_count " << snapshot.count << "\n";
+    };
+
+    counter("enqueued_total", "Messages enqueued for formatting.", enqueued);
+    counter("sampled_out_total", "Messages dropped by load sampling.", sampled_out);
+    counter("rate_limited_total", "Messages dropped by call site rate limits.", rate_limited);
+    counter("formatted_total", "Messages formatted.", formatted);
+    counter("deduplicated_total", "Repeated messages collapsed.", deduplicated);
+    counter("console_written_total", "Messages written to the console.", console_written);
+    counter("console_bytes_total", "Bytes written to the console.", console_bytes);
+    counter("console_dropped_total", "Console messages dropped because the output would block.", console_dropped);
+    counter("file_written_total", "Messages written to files.", file_written);
+    counter("file_bytes_total", "Bytes written to files.", file_bytes);
+    counter("shared_dropped_total", "Messages dropped because the shared multi-process buffer was full.",
+            shared_dropped);
+    gauge("format_queue_depth", "Current length of the format queue.", format_queue_depth);
+    gauge("format_queue_high_watermark", "Maximum length of the format queue.", format_queue_high_watermark);
+    gauge("console_queue_high_watermark", "Maximum length of the console output queue.",
+          console_queue_high_watermark);
+    gauge("file_queue_high_watermark", "Maximum length of the file output queue.", file_queue_high_watermark);
+    gauge("arena_used_bytes", "Bytes of the task arena in use.", arena_used_bytes);
+    counter("arena_fallbacks_total", "Task allocations that fell back to the heap.", arena_fallbacks);
+    histogram("format_seconds", "Time spent formatting one message.", format_time);
+    histogram("console_write_seconds", "Time spent writing one batch to the console.", console_write_time);
+    histogram("file_write_seconds", "Time spent writing one message to a file.", file_write_time);
+
+    return oss.str();
+}
+
+#endif // MYLOGGER_STATS_INL_HPP
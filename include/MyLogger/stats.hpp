@@ -0,0 +1,140 @@
+// 日志库自身的运行统计: 生产者线程的计数器、后台线程的计数器与耗时直方图，以及汇总后的快照。
+// 生产者的计数器按线程独立存放，后台线程的计数器只由对应的线程写入，因此统计不会在日志调用路径上引入共享缓存行的写操作。
+
+#pragma once
+
+#ifndef MYLOGGER_STATS_HPP
+#define MYLOGGER_STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// 耗时直方图的快照。第 i 个桶统计耗时在 [2^(i-1), 2^i) 纳秒内的次数，第 0 个桶统计耗时为 0 的次数;
+// 最后一个桶没有上界，统计耗时不小于 2^(kBuckets-2) 纳秒(约 1.07 秒)的次数。
+struct HistogramSnapshot {
+    static constexpr std::size_t kBuckets = 32;
+
+    std::array<unsigned long long, kBuckets> buckets{};
+    unsigned long long count = 0;
+    unsigned long long sum_ns = 0;
+};
+
+// 由 Logger::stats() 返回的统计快照
+struct LoggerStats {
+    // 生产者(日志调用线程)
+    unsigned long long enqueued = 0;     // 进入格式化队列的日志条数
+    unsigned long long sampled_out = 0;  // 被负载采样丢弃的日志条数
+    unsigned long long rate_limited = 0; // 被调用点限流丢弃的日志条数
+
+    // 格式化线程
+    unsigned long long formatted = 0;    // 格式化完成的日志条数
+    unsigned long long deduplicated = 0; // 被折叠的重复日志条数
+    HistogramSnapshot format_time;       // 单条日志的格式化耗时
+
+    // 输出线程
+    unsigned long long console_written = 0; // 写入控制台的日志条数
+    unsigned long long console_bytes = 0;   // 写入控制台的字节数
+    unsigned long long console_dropped = 0; // 非阻塞模式下因输出管道已满而丢弃的控制台日志条数
+    unsigned long long file_written = 0;    // 写入文件的日志条数
+    unsigned long long file_bytes = 0;      // 写入文件的字节数
+    unsigned long long shared_dropped = 0;  // 多进程模式下因共享缓冲区已满而丢弃的日志条数(所有进程)
+    HistogramSnapshot console_write_time;   // 一批日志写入控制台的耗时
+    HistogramSnapshot file_write_time;      // 单条日志写入文件的耗时
+
+    // 队列
+    std::size_t format_queue_depth = 0;           // 当前格式化队列长度
+    std::size_t format_queue_high_watermark = 0;  // 格式化队列长度的历史最大值
+    std::size_t console_queue_high_watermark = 0; // 控制台输出队列长度的历史最大值
+    std::size_t file_queue_high_watermark = 0;    // 文件输出队列长度的历史最大值
+
+    // 任务内存区(BackendOptions::arena)
+    std::size_t arena_used_bytes = 0;       // 正在使用的块的总字节数
+    unsigned long long arena_fallbacks = 0; // 因预算耗尽或分配过大而退化为 new 的次数
+
+    // 转换为 Prometheus 文本格式
+    std::string toPrometheus() const;
+};
+
+// 单写者计数器: 只由一个线程修改，其他线程可随时读取。修改时不需要原子的读-改-写指令。
+class Counter {
+  private:
+    std::atomic<unsigned long long> m_value{0};
+
+  public:
+    void add(unsigned long long n = 1) {
+        m_value.store(m_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    void max(unsigned long long n) {
+        if (n > m_value.load(std::memory_order_relaxed))
+            m_value.store(n, std::memory_order_relaxed);
+    }
+    unsigned long long get() const {
+        return m_value.load(std::memory_order_relaxed);
+    }
+};
+
+// 单写者耗时直方图，按 2 的幂划分桶
+class Histogram {
+  private:
+    std::array<Counter, HistogramSnapshot::kBuckets> m_buckets;
+    Counter m_count;
+    Counter m_sum_ns;
+
+  public:
+    void record(std::chrono::nanoseconds elapsed);
+    HistogramSnapshot snapshot() const;
+};
+
+// 生产者线程的计数器。每个线程一份，线程退出时将计数累加到 retired 中。
+class ProducerCounters {
+  private:
+    // 友元类声明，仅允许 Logger 类访问私有成员
+    friend class Logger;
+    friend class ThreadsPool;
+
+  private:
+    // 所有线程的计数器登记表，只在线程首次记录日志与退出时加锁
+    struct Registry {
+        std::mutex mtx;
+        std::vector<ProducerCounters*> threads;
+        unsigned long long retired_enqueued = 0;
+        unsigned long long retired_sampled_out = 0;
+    };
+
+  private:
+    Counter m_enqueued;
+    Counter m_sampled_out;
+
+    // 当前线程持有的日志配置，见 Logger::ConfigPin. 借用计数器的登记表，修改配置时据此判断旧配置能否释放。
+    std::atomic<const void*> m_config_pin{nullptr};
+
+  private:
+    ProducerCounters();
+    ~ProducerCounters();
+    ProducerCounters(const ProducerCounters&) = delete;
+    ProducerCounters& operator=(const ProducerCounters&) = delete;
+
+    static Registry& registry();
+
+    // 当前线程的计数器
+    static ProducerCounters& local();
+
+    // 将所有线程的计数累加到 stats 中
+    static void collect(LoggerStats& stats);
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_STATS_INL_HPP
+#include "stats-inl.hpp"
+MYLOGGER_STATS_INL_HPP
+#endif // MYLOGGER_STATS_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_STATS_HPP
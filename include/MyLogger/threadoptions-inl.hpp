@@ -0,0 +1,103 @@
+// threadoptions 的具体实现
+
+#pragma once
+
+#ifndef MYLOGGER_THREADOPTIONS_INL_HPP
+#define MYLOGGER_THREADOPTIONS_INL_HPP
+
+#ifndef MYLOGGER_THREADOPTIONS_HPP
+#include "threadoptions.hpp"
+#endif // MYLOGGER_THREADOPTIONS_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+MYLOGGER_INLINE int ThreadOptions::applyToCurrentThread(const std::string& default_name) const {
+#ifdef __linux__
+    std::string thread_name = (name.empty() ? default_name : name).substr(0, 15);
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+
+    if (!cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &cpu_set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        sched_param param{};
+        param.sched_priority = priority;
+        pthread_setschedparam(pthread_self(), policy, &param);
+    } else {
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), policy, &param);
+        // Linux 上 nice 值是线程级别的
+        if (nice != 0)
+            setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), nice);
+    }
+
+    return cpus.empty() ? -1 : numaNodeOfCpu(cpus.front());
+#else
+    std::ignore = default_name;
+    return -1;
+#endif
+}
+
+MYLOGGER_INLINE void ThreadOptions::bindMemoryToNode(const void* addr, std::size_t length, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (node < 0 || node >= 64 || length == 0)
+        return;
+
+    // 不依赖 libnuma, 直接使用 mbind 系统调用。常量取自 <linux/mempolicy.h>.
+    const int mpol_preferred = 1;
+    const unsigned int mpol_mf_move = 1u << 1;
+
+    std::uintptr_t page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(addr) & ~(page_size - 1);
+    std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(addr) + length + page_size - 1) & ~(page_size - 1);
+    unsigned long node_mask = 1ul << node;
+    syscall(SYS_mbind, begin, end - begin, mpol_preferred, &node_mask, sizeof(node_mask) * 8, mpol_mf_move);
+#else
+    std::ignore = addr;
+    std::ignore = length;
+    std::ignore = node;
+#endif
+}
+
+MYLOGGER_INLINE int ThreadOptions::numaNodeOfCpu(int cpu) {
+#ifdef __linux__
+    // /sys/devices/system/cpu/cpuN/ 下有一个名为 nodeM 的链接指向所在的节点
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (!dir)
+        return -1;
+
+    int node = -1;
+    while (dirent* entry = readdir(dir)) {
+        std::string entry_name = entry->d_name;
+        if (entry_name.size() > 4 && entry_name.compare(0, 4, "node") == 0) {
+            node = std::atoi(entry_name.c_str() + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+#else
+    std::ignore = cpu;
+    return -1;
+#endif
+}
+
+#endif // MYLOGGER_THREADOPTIONS_INL_HPP
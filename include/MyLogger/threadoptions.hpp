@@ -0,0 +1,70 @@
+// 后台线程的运行参数: 线程名、CPU 亲和性、调度策略与优先级。
+// 需要在第一次输出日志之前通过 Logger::setBackendOptions() 设置，后台线程启动后不能再修改。
+
+#pragma once
+
+#ifndef MYLOGGER_THREADOPTIONS_HPP
+#define MYLOGGER_THREADOPTIONS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "arena.hpp"
+
+struct ThreadOptions {
+    std::string name;         // 线程名(最多 15 个字符)，为空时使用默认名称
+    std::vector<int> cpus;    // 绑定的 CPU 编号，为空表示不绑定
+    int nice = 0;             // nice 值，仅在 policy 为 SCHED_OTHER/SCHED_BATCH/SCHED_IDLE 时生效
+    int policy = SCHED_OTHER; // 调度策略: SCHED_OTHER/SCHED_BATCH/SCHED_IDLE/SCHED_FIFO/SCHED_RR
+    int priority = 0;         // 实时优先级，仅在 policy 为 SCHED_FIFO/SCHED_RR 时生效
+
+    // 将参数应用到当前线程。后台线程无法向调用者报告错误，因此每一项都是尽力而为，失败时保持系统默认值。
+    // 返回第一个绑定的 CPU 所在的 NUMA 节点，未绑定或无法确定时返回 -1.
+    int applyToCurrentThread(const std::string& default_name) const;
+
+    // 将 [addr, addr + length) 所在的内存页优先放置(并迁移)到 node 节点上。尽力而为。
+    static void bindMemoryToNode(const void* addr, std::size_t length, int node);
+
+    // 获取 CPU 所在的 NUMA 节点，无法确定时返回 -1
+    static int numaNodeOfCpu(int cpu);
+};
+
+// 后台线程等待新任务的方式
+enum class WaitStrategy {
+    BLOCKING,       // 在条件变量上休眠，生产者仅在后台线程休眠时唤醒它(默认)
+    SPIN_THEN_PARK, // 先自旋 spin_count 次，仍无任务时再休眠
+    BUSY_POLL,      // 始终自旋，延迟最低，但每个后台线程独占一个 CPU 核心
+    TIMED,          // 每隔 batch_interval 醒来一次处理积压的全部任务，生产者从不唤醒后台线程，批处理效果最好
+};
+
+struct BackendOptions {
+    ThreadOptions format;         // 格式化线程，默认名称 "mylog-format"
+    ThreadOptions console_output; // 控制台输出线程，默认名称 "mylog-console"
+    ThreadOptions file_output;    // 文件输出线程，默认名称 "mylog-file"
+
+    WaitStrategy wait_strategy = WaitStrategy::BLOCKING;
+    unsigned int spin_count = 10000;              // SPIN_THEN_PARK 休眠前的自旋次数
+    std::chrono::milliseconds batch_interval{10}; // TIMED 的唤醒间隔
+
+    // 格式化队列长度达到该值时，协程接口 Logger::infoAsync() 等挂起调用协程(见 awaitable.hpp)，0 表示不限制
+    std::size_t async_queue_limit = 8192;
+
+    // 任务队列使用的预分配内存区，默认不启用，见 arena.hpp
+    ArenaOptions arena;
+
+    // WARNING/ERROR 日志进入各队列的高优先级通道，优先于积压的 DEBUG/INFO 日志处理，见 threadspool.hpp
+    bool priority_lanes = true;
+};
+
+#ifdef MYLOGGER_HEADER_ONLY
+#ifndef MYLOGGER_THREADOPTIONS_INL_HPP
+#include "threadoptions-inl.hpp"
+MYLOGGER_THREADOPTIONS_INL_HPP
+#endif // MYLOGGER_THREADOPTIONS_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
+
+#endif // MYLOGGER_THREADOPTIONS_HPP
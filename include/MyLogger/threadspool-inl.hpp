@@ -9,88 +9,327 @@
 #include "threadspool.hpp"
 #endif // MYLOGGER_THREADSPOOL_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdexcept>
 #include <utility>
 
-template <typename Func, typename... Args>
-void ThreadsPool::addFormatTask(Func&& func, Args&&... args) {
-    auto task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
-    {
-        std::unique_lock<std::mutex> lock(m_format_mtx);
-        m_format_queue.emplace(std::move(task));
-        // std::cout << "Add task to format thread queue.\n";
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "formatterpool.hpp"
+#include "logwriter.hpp"
+
+MYLOGGER_INLINE void ThreadsPool::TaskQueue::push(LogTask&& task, Lane lane, std::uint64_t producer) {
+    std::uint64_t seq = m_next_seq++;
+    Mark& mark = m_marks[producer % kMarks];
+
+    if (lane == Lane::URGENT) {
+        std::uint64_t after = m_last_normal;
+        if (producer != 0)
+            after = mark.producer == producer ? mark.seq : mark.floor;
+        m_urgent.push_back(Entry{std::move(task), seq, after});
+        return;
+    }
+
+    m_normal.push_back(Entry{std::move(task), seq, 0});
+    m_last_normal = seq;
+    if (producer != 0) {
+        if (mark.producer != producer) {
+            mark.floor = std::max(mark.floor, mark.seq);
+            mark.producer = producer;
+        }
+        mark.seq = seq;
     }
-    m_format_condition.notify_one();
 }
 
-template <typename Func, typename... Args>
-void ThreadsPool::addConsoleOutputTask(Func&& func, Args&&... args) {
-    auto task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
-    {
-        std::unique_lock<std::mutex> lock(m_console_output_mtx);
-        m_console_output_queue.emplace(std::move(task));
-        // std::cout << "Add task to console output thread queue.\n";
+MYLOGGER_INLINE LogTask ThreadsPool::TaskQueue::pop() {
+    // 普通通道为空，或者其第一个任务晚于 after: 同一生产者之前的普通任务都已取出
+    bool urgent = !m_urgent.empty() && (m_normal.empty() || m_normal.front().seq > m_urgent.front().after);
+    auto& lane = urgent ? m_urgent : m_normal;
+    LogTask task(std::move(lane.front().task));
+    lane.pop_front();
+    return task;
+}
+
+MYLOGGER_INLINE bool ThreadsPool::TaskQueue::empty() const {
+    return m_normal.empty() && m_urgent.empty();
+}
+
+MYLOGGER_INLINE std::size_t ThreadsPool::TaskQueue::size() const {
+    return m_normal.size() + m_urgent.size();
+}
+
+MYLOGGER_INLINE void ThreadsPool::TaskQueue::clear() {
+    m_normal.clear();
+    m_urgent.clear();
+}
+
+MYLOGGER_INLINE std::uint64_t ThreadsPool::producerId() {
+    static std::atomic<std::uint64_t> next(1);
+    static thread_local std::uint64_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+MYLOGGER_INLINE ThreadsPool::Lane ThreadsPool::laneOf(LogLevel level) const {
+    return m_priority_lanes && level >= LogLevel::WARNING ? Lane::URGENT : Lane::NORMAL;
+}
+
+MYLOGGER_INLINE bool ThreadsPool::hasAsyncSpace() const {
+    return m_async_queue_limit == 0 || m_format_queue_size.load(std::memory_order_relaxed) < m_async_queue_limit;
+}
+
+MYLOGGER_INLINE bool ThreadsPool::waitForAsyncSpace(std::function<void(void)> resume) {
+    std::unique_lock<std::mutex> lock(m_format_mtx);
+    if (m_stop.load(std::memory_order_relaxed) || m_async_queue_limit == 0 ||
+        m_format_queue.size() < m_async_queue_limit)
+        return false;
+    m_async_waiters.push_back(std::move(resume));
+    return true;
+}
+
+MYLOGGER_INLINE ThreadsPool::Options& ThreadsPool::options() {
+    static Options instance;
+    return instance;
+}
+
+MYLOGGER_INLINE void ThreadsPool::configure(const BackendOptions& backend) {
+    Options& opts = options();
+    std::unique_lock<std::mutex> lock(opts.mtx);
+    if (opts.started) {
+        throw std::runtime_error("Backend options must be set before the first message is logged.");
     }
-    m_console_output_condition.notify_one();
+    opts.backend = backend;
+}
+
+MYLOGGER_INLINE void ThreadsPool::cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
 }
 
-template <typename Func, typename... Args>
-void ThreadsPool::addFileOutputTask(Func&& func, Args&&... args) {
-    auto task = std::bind(std::forward<Func>(func), std::forward<Args>(args)...);
+template <typename Ready>
+void ThreadsPool::waitForTask(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                              const std::atomic<std::size_t>& size, bool& waiting, Ready&& ready,
+                              std::chrono::steady_clock::time_point deadline) {
+    // 自旋时只读取原子的队列长度，不与生产者争抢锁; 每隔一段时间加锁检查一次 ready(), 以便响应退出请求
+    auto spin = [&](unsigned int count) {
+        for (unsigned int i = 0; i < count && size.load(std::memory_order_relaxed) == 0; i++) {
+            cpuRelax();
+        }
+    };
+    // 没有截止时间时不读取时钟
+    const bool timed = deadline != std::chrono::steady_clock::time_point::max();
+    auto expired = [&](void) -> bool { return timed && std::chrono::steady_clock::now() >= deadline; };
+
+    switch (m_wait_strategy) {
+    case WaitStrategy::BUSY_POLL:
+        while (!ready() && !expired()) {
+            lock.unlock();
+            spin(1024);
+            lock.lock();
+        }
+        return;
+
+    case WaitStrategy::TIMED:
+        // 生产者不会唤醒后台线程(waiting 始终为 false)，只在超时或退出时醒来
+        while (!ready() && !expired()) {
+            std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now() + m_batch_interval;
+            condition.wait_until(lock, timed ? std::min(wake, deadline) : wake);
+        }
+        return;
+
+    case WaitStrategy::SPIN_THEN_PARK:
+        if (!ready()) {
+            lock.unlock();
+            spin(m_spin_count);
+            lock.lock();
+        }
+        [[fallthrough]];
+
+    case WaitStrategy::BLOCKING:
+        while (!ready() && !expired()) {
+            waiting = true;
+            if (timed)
+                condition.wait_until(lock, deadline);
+            else
+                condition.wait(lock);
+            waiting = false;
+        }
+        return;
+    }
+}
+
+MYLOGGER_INLINE ThreadsPool::ThreadsPool()
+    : m_format_queue_size(0), m_format_waiting(false), m_format_busy(false), m_console_output_queue_size(0),
+      m_console_output_waiting(false), m_console_output_busy(false), m_file_output_queue_size(0),
+      m_file_output_waiting(false), m_file_output_busy(false), m_stop(false), m_format_stop(false),
+      m_fork_pending(false), m_priority_lanes(true), m_async_queue_limit(0) {
+    BackendOptions backend;
     {
-        std::unique_lock<std::mutex> lock(m_file_output_mtx);
-        m_file_output_queue.emplace(std::move(task));
-        // std::cout << "Add task to file output thread queue.\n";
+        Options& opts = options();
+        std::unique_lock<std::mutex> lock(opts.mtx);
+        opts.started = true;
+        backend = opts.backend;
     }
-    m_file_output_condition.notify_one();
+    // 输出线程使用的静态对象先于线程池构造完成，从而在输出线程退出之后才析构。
+    // 后台线程中恢复的协程也会记录日志，其线程局部计数器在线程退出时访问登记表。
+    LogWriter::metrics();
+    LogWriter::console();
+    FileIndex::state();
+    ProducerCounters::registry();
+
+    LogArena::getArena().configure(backend.arena);
+
+    m_wait_strategy = backend.wait_strategy;
+    m_spin_count = backend.spin_count;
+    m_batch_interval = backend.batch_interval;
+    m_async_queue_limit = backend.async_queue_limit;
+    m_priority_lanes = backend.priority_lanes;
+    m_backend = backend;
+
+    startThreads(backend);
+
+#ifdef __linux__
+    // 进程中只有一个线程池，fork 处理函数只需注册一次
+    static const bool registered = pthread_atfork(prepareFork, parentAfterFork, childAfterFork) == 0;
+    (void)registered;
+#endif
+    forkTarget().store(this, std::memory_order_release);
 }
 
-inline ThreadsPool::ThreadsPool() : m_stop(false), m_format_stop(false) {
-    m_format_thread = std::thread([this] {
+MYLOGGER_INLINE void ThreadsPool::startThreads(const BackendOptions& backend) {
+    m_format_thread = std::thread([this, thread_options = backend.format] {
+        // Formatter 主要由格式化线程填充，将对象池迁移到格式化线程所在的 NUMA 节点
+        int node = thread_options.applyToCurrentThread("mylog-format");
+        if (node >= 0) {
+            FormatterPool& pool = FormatterPool::getFormatterPool();
+            ThreadOptions::bindMemoryToNode(pool.m_slots.get(), sizeof(FormatterPool::Slot) * FormatterPool::kCapacity,
+                                            node);
+        }
+
+        // 定时任务在 m_format_busy 为 true 时执行，fork() 前会等它执行完
+        auto run_timer = [] {
+            auto hook = timerHook().load(std::memory_order_acquire);
+            return hook ? hook() : std::chrono::steady_clock::time_point::max();
+        };
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
         while (true) {
             std::unique_lock<std::mutex> lock(m_format_mtx);
-            m_format_condition.wait(lock, [&](void) -> bool { return !m_format_queue.empty() || m_stop; });
-            if (m_stop && m_format_queue.empty()) {
-                m_format_stop = true;
+            m_format_busy = false;
+            waitForTask(
+                lock, m_format_condition, m_format_queue_size, m_format_waiting,
+                [&](void) -> bool {
+                    return (!m_format_queue.empty() && !m_fork_pending) || m_stop.load(std::memory_order_relaxed);
+                },
+                deadline);
+            if (m_stop.load(std::memory_order_relaxed) && m_format_queue.empty()) {
+                // 输出线程在 m_format_stop 置位之前不会退出，drainHook 提交的输出任务仍会被处理
+                lock.unlock();
+                if (void (*hook)() = drainHook().load(std::memory_order_acquire))
+                    hook();
+                m_format_stop.store(true, std::memory_order_release);
                 return;
             }
+            if (m_format_queue.empty() || m_fork_pending) {
+                // 等待超时。fork() 前停下期间不执行定时任务，等待 fork() 返回后的唤醒
+                if (m_fork_pending) {
+                    m_format_condition.wait(lock);
+                    continue;
+                }
+                m_format_busy = true;
+                lock.unlock();
+                deadline = run_timer();
+                continue;
+            }
+
+            m_format_queue_high_watermark.max(m_format_queue.size());
+            LogTask task(m_format_queue.pop());
+            m_format_queue_size.store(m_format_queue.size(), std::memory_order_relaxed);
+            m_format_busy = true;
 
-            auto task(std::move(m_format_queue.front()));
-            m_format_queue.pop();
+            // 队列腾出空间后恢复所有挂起的协程，在锁外调用以免恢复的协程再次提交日志时死锁
+            std::vector<std::function<void(void)>> waiters;
+            if (!m_async_waiters.empty() && m_format_queue.size() < m_async_queue_limit)
+                waiters.swap(m_async_waiters);
             lock.unlock();
+            for (auto& resume : waiters) {
+                resume();
+            }
+
+            auto start = std::chrono::steady_clock::now();
             task();
+            auto end = std::chrono::steady_clock::now();
+            m_format_time.record(end - start);
+
+            // 任务可能开始了新的一段重复日志，队列为空时重新计算下一次定时任务的时间
+            if (end >= deadline || m_format_queue_size.load(std::memory_order_relaxed) == 0)
+                deadline = run_timer();
         }
     });
 
-    m_console_output_thread = std::thread([this] {
+    m_console_output_thread = std::thread([this, thread_options = backend.console_output] {
+        thread_options.applyToCurrentThread("mylog-console");
+
         while (true) {
             std::unique_lock<std::mutex> lock(m_console_output_mtx);
-            m_console_output_condition.wait(lock, [&](void) -> bool { return !m_console_output_queue.empty() || m_stop; });
-            if (m_stop && m_console_output_queue.empty() && m_format_stop) {
+            m_console_output_busy = false;
+            waitForTask(lock, m_console_output_condition, m_console_output_queue_size, m_console_output_waiting,
+                        [&](void) -> bool {
+                            return (!m_console_output_queue.empty() && !m_fork_pending) ||
+                                   m_stop.load(std::memory_order_relaxed);
+                        });
+            if (m_stop.load(std::memory_order_relaxed) && m_console_output_queue.empty() &&
+                m_format_stop.load(std::memory_order_acquire)) {
+                LogWriter::flushConsole();
                 break;
             }
 
             if (!m_console_output_queue.empty()) {
-                auto task(std::move(m_console_output_queue.front()));
-                m_console_output_queue.pop();
+                m_console_queue_high_watermark.max(m_console_output_queue.size());
+                LogTask task(m_console_output_queue.pop());
+                m_console_output_queue_size.store(m_console_output_queue.size(), std::memory_order_relaxed);
+                m_console_output_busy = true;
                 lock.unlock();
                 task();
+
+                // 队列已空: 将缓冲的日志一次性写入，队列中仍有日志时继续积攒
+                if (m_console_output_queue_size.load(std::memory_order_relaxed) == 0)
+                    LogWriter::flushConsole();
             } else {
                 lock.unlock();
             }
         }
     });
 
-    m_file_output_thread = std::thread([this] {
+    m_file_output_thread = std::thread([this, thread_options = backend.file_output] {
+        thread_options.applyToCurrentThread("mylog-file");
+
         while (true) {
             std::unique_lock<std::mutex> lock(m_file_output_mtx);
-            m_file_output_condition.wait(lock, [&](void) -> bool { return !m_file_output_queue.empty() || m_stop; });
-            if (m_stop && m_file_output_queue.empty() && m_format_stop) {
+            m_file_output_busy = false;
+            waitForTask(lock, m_file_output_condition, m_file_output_queue_size, m_file_output_waiting,
+                        [&](void) -> bool {
+                            return (!m_file_output_queue.empty() && !m_fork_pending) ||
+                                   m_stop.load(std::memory_order_relaxed);
+                        });
+            if (m_stop.load(std::memory_order_relaxed) && m_file_output_queue.empty() &&
+                m_format_stop.load(std::memory_order_acquire)) {
                 break;
             }
 
             if (!m_file_output_queue.empty()) {
-                auto task(std::move(m_file_output_queue.front()));
-                m_file_output_queue.pop();
+                m_file_queue_high_watermark.max(m_file_output_queue.size());
+                LogTask task(m_file_output_queue.pop());
+                m_file_output_queue_size.store(m_file_output_queue.size(), std::memory_order_relaxed);
+                m_file_output_busy = true;
                 lock.unlock();
                 task();
             } else {
@@ -100,12 +339,13 @@ inline ThreadsPool::ThreadsPool() : m_stop(false), m_format_stop(false) {
     });
 }
 
-inline ThreadsPool::~ThreadsPool() {
+MYLOGGER_INLINE ThreadsPool::~ThreadsPool() {
+    forkTarget().store(nullptr, std::memory_order_release);
     {
         std::unique_lock<std::mutex> format_console_lock(m_format_mtx);
         std::unique_lock<std::mutex> output_console_lock(m_console_output_mtx);
         std::unique_lock<std::mutex> output_file_lock(m_file_output_mtx);
-        m_stop = true;
+        m_stop.store(true, std::memory_order_relaxed);
     }
 
     m_format_condition.notify_all();
@@ -120,7 +360,157 @@ inline ThreadsPool::~ThreadsPool() {
         m_file_output_thread.join();
 }
 
-inline ThreadsPool& ThreadsPool::getThreadsPool() {
+MYLOGGER_INLINE std::atomic<void (*)()>& ThreadsPool::drainHook() {
+    static std::atomic<void (*)()> hook(nullptr);
+    return hook;
+}
+
+MYLOGGER_INLINE std::atomic<std::chrono::steady_clock::time_point (*)()>& ThreadsPool::timerHook() {
+    static std::atomic<std::chrono::steady_clock::time_point (*)()> hook(nullptr);
+    return hook;
+}
+
+MYLOGGER_INLINE std::atomic<ThreadsPool*>& ThreadsPool::forkTarget() {
+    static std::atomic<ThreadsPool*> pool(nullptr);
+    return pool;
+}
+
+MYLOGGER_INLINE void ThreadsPool::quiesce(std::mutex& mtx, std::condition_variable& condition, const bool& busy) {
+    // busy 只在后台线程持锁时修改: 持锁且 busy 为 false 时，后台线程必然在等待任务或等待这把锁,
+    // 而 m_fork_pending 已置位，它拿到锁后也不会再取出任务
+    mtx.lock();
+    while (busy) {
+        mtx.unlock();
+        condition.notify_one();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        mtx.lock();
+    }
+}
+
+MYLOGGER_INLINE ThreadsPool::ForkLocks& ThreadsPool::forkLocks() {
+    static ForkLocks instance;
+    return instance;
+}
+
+MYLOGGER_INLINE void ThreadsPool::addForkLock(std::mutex& mtx) {
+    ForkLocks& extra = forkLocks();
+    std::unique_lock<std::mutex> lock(extra.mtx);
+    extra.locks.push_back(&mtx);
+}
+
+MYLOGGER_INLINE void ThreadsPool::prepareFork() {
+    ThreadsPool* pool = forkTarget().load(std::memory_order_acquire);
+    if (!pool) {
+        ForkLocks& extra = forkLocks();
+        extra.mtx.lock();
+        for (std::mutex* mtx : extra.locks)
+            mtx->lock();
+        return;
+    }
+
+    // 先给后台线程一点时间处理已提交的任务; 仍有线程在持续记录日志时队列可能始终不空，到时间后直接进入下一步
+    auto deadline = std::chrono::steady_clock::now() + kForkDrainTimeout;
+    while (std::chrono::steady_clock::now() < deadline &&
+           (pool->m_format_queue_size.load(std::memory_order_relaxed) != 0 ||
+            pool->m_console_output_queue_size.load(std::memory_order_relaxed) != 0 ||
+            pool->m_file_output_queue_size.load(std::memory_order_relaxed) != 0)) {
+        // TIMED 等待策略下生产者不会唤醒后台线程
+        pool->m_format_condition.notify_one();
+        pool->m_console_output_condition.notify_one();
+        pool->m_file_output_condition.notify_one();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    // 格式化线程最先停下，此后只有生产者会向输出队列提交任务
+    pool->m_fork_pending.store(true, std::memory_order_relaxed);
+    pool->quiesce(pool->m_format_mtx, pool->m_format_condition, pool->m_format_busy);
+    pool->quiesce(pool->m_console_output_mtx, pool->m_console_output_condition, pool->m_console_output_busy);
+    pool->quiesce(pool->m_file_output_mtx, pool->m_file_output_condition, pool->m_file_output_busy);
+    ForkLocks& extra = forkLocks();
+    extra.mtx.lock();
+    for (std::mutex* mtx : extra.locks)
+        mtx->lock();
+    ProducerCounters::registry().mtx.lock();
+}
+
+MYLOGGER_INLINE void ThreadsPool::parentAfterFork() {
+    ThreadsPool* pool = forkTarget().load(std::memory_order_acquire);
+    ForkLocks& extra = forkLocks();
+    if (!pool) {
+        for (std::mutex* mtx : extra.locks)
+            mtx->unlock();
+        extra.mtx.unlock();
+        return;
+    }
+
+    pool->m_fork_pending.store(false, std::memory_order_relaxed);
+    ProducerCounters::registry().mtx.unlock();
+    for (std::mutex* mtx : extra.locks)
+        mtx->unlock();
+    extra.mtx.unlock();
+    pool->m_file_output_mtx.unlock();
+    pool->m_console_output_mtx.unlock();
+    pool->m_format_mtx.unlock();
+
+    // fork 期间停下的后台线程可能正在条件变量上休眠，而队列中已有任务
+    pool->m_format_condition.notify_one();
+    pool->m_console_output_condition.notify_one();
+    pool->m_file_output_condition.notify_one();
+}
+
+MYLOGGER_INLINE void ThreadsPool::childAfterFork() {
+    ThreadsPool* pool = forkTarget().load(std::memory_order_acquire);
+    ForkLocks& extra = forkLocks();
+    if (!pool) {
+        for (std::mutex* mtx : extra.locks)
+            mtx->unlock();
+        extra.mtx.unlock();
+        return;
+    }
+
+    // 子进程中只有调用 fork() 的线程，它就是这些锁的持有者
+    ProducerCounters::registry().mtx.unlock();
+    for (std::mutex* mtx : extra.locks)
+        mtx->unlock();
+    extra.mtx.unlock();
+    pool->m_file_output_mtx.unlock();
+    pool->m_console_output_mtx.unlock();
+    pool->m_format_mtx.unlock();
+
+    // 未处理完的任务属于父进程，由父进程的后台线程输出，子进程中丢弃。格式化任务持有的 Formatter 随任务一起丢弃，
+    // fork() 时正在提交日志的其他线程取出的 Formatter 也不会再归还: 子进程中不再有任何持有者，全部收回到池中
+    pool->m_format_queue.clear();
+    pool->m_console_output_queue.clear();
+    pool->m_file_output_queue.clear();
+    FormatterPool::getFormatterPool().reclaimAll();
+    pool->m_format_queue_size.store(0, std::memory_order_relaxed);
+    pool->m_console_output_queue_size.store(0, std::memory_order_relaxed);
+    pool->m_file_output_queue_size.store(0, std::memory_order_relaxed);
+    pool->m_format_waiting = pool->m_console_output_waiting = pool->m_file_output_waiting = false;
+    pool->m_format_busy = pool->m_console_output_busy = pool->m_file_output_busy = false;
+    pool->m_fork_pending.store(false, std::memory_order_relaxed);
+    pool->m_async_waiters.clear();
+    LogWriter::Console& console = LogWriter::console();
+    console.out.buffer.clear();
+    console.out.ends.clear();
+    console.err.buffer.clear();
+    console.err.ends.clear();
+    // 尚未结束的索引块由父进程结束
+    FileIndex::state().blocks.clear();
+
+    // 条件变量中记录着父进程里等待的线程，子进程中直接通知会一直等待这些不存在的线程，需要重新构造
+    new (&pool->m_format_condition) std::condition_variable();
+    new (&pool->m_console_output_condition) std::condition_variable();
+    new (&pool->m_file_output_condition) std::condition_variable();
+
+    // 父进程的后台线程在子进程中不存在，不能 join 或 detach: 直接在原位置构造空的 std::thread 后重新启动
+    new (&pool->m_format_thread) std::thread();
+    new (&pool->m_console_output_thread) std::thread();
+    new (&pool->m_file_output_thread) std::thread();
+    pool->startThreads(pool->m_backend);
+}
+
+MYLOGGER_INLINE ThreadsPool& ThreadsPool::getThreadsPool() {
     static ThreadsPool instance;
     return instance;
 }
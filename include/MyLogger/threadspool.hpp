@@ -1,39 +1,138 @@
 // 线程池类
+//
+// 优先级通道: 每个队列分为普通通道(DEBUG/INFO 日志与其他任务)与高优先级通道(WARNING/ERROR 日志)，
+// 后台线程优先取出高优先级通道中的任务，ERROR 日志不必排在大量 DEBUG 日志之后。
+// 同一个生产者线程的日志仍按提交的顺序输出: 高优先级任务记录同一生产者在普通通道中最后一个任务的序号(after)，
+// 该任务被取出之前高优先级任务不会被取出。两个通道中最早提交的任务总是可以取出，因此不会互相等待。
+// 输出队列中的任务由格式化线程提交，生产者编号随 Formatter 传递，同样保持每个生产者的顺序。
+// 重复日志的汇总信息记在结束这一段重复日志的那条日志的生产者名下，飞行记录器的转储记在触发它的 ERROR 的生产者名下,
+// 不属于任何生产者的任务(flush、回收配置)只放在普通通道中，都不会让无关生产者的 ERROR 等待普通通道中的积压。
 
 #pragma once
 
 #ifndef MYLOGGER_THREADSPOOL_HPP
 #define MYLOGGER_THREADSPOOL_HPP
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "arena.hpp"
+#include "loglevel.hpp"
+#include "stats.hpp"
+#include "threadoptions.hpp"
 
 class ThreadsPool {
   private:
     friend class Logger;
+    friend class FlightRecorder;
+    friend class LogWriter;
+    friend class AsyncResumer;
+    template <typename Submit>
+    friend class LogAwaitable;
+
+    // 任务所在的通道
+    enum class Lane { NORMAL, URGENT };
+
+    // 分为两个通道的任务队列，受对应队列的锁保护。任务与队列的节点都从 LogArena 中分配。
+    class TaskQueue {
+      private:
+        struct Entry {
+            LogTask task;
+            std::uint64_t seq;   // 提交的序号，两个通道共用
+            std::uint64_t after; // 仅高优先级任务: 普通通道中序号不大于 after 的任务都被取出后才能取出
+        };
+
+        // 生产者在普通通道中最后一个任务的序号。按生产者编号直接映射，冲突时覆盖，被覆盖的序号记入 floor:
+        // 找不到自己的记录的生产者以 floor 为准(可能多等一些任务，但不会乱序)，占用的内存不随线程数增长。
+        struct Mark {
+            std::uint64_t producer = 0;
+            std::uint64_t seq = 0;
+            std::uint64_t floor = 0;
+        };
+        static constexpr std::size_t kMarks = 256;
+
+        std::deque<Entry, LogArenaAllocator<Entry>> m_normal;
+        std::deque<Entry, LogArenaAllocator<Entry>> m_urgent;
+        std::array<Mark, kMarks> m_marks{};
+        std::uint64_t m_next_seq = 1;
+        std::uint64_t m_last_normal = 0; // 普通通道中最后一个任务的序号
+
+      public:
+        // producer 为提交任务的生产者编号(producerId()), 0 表示不属于任何生产者: 此时高优先级任务等待之前的所有
+        // 普通任务(并因通道先进先出而阻塞之后的所有高优先级任务，日志路径上不使用); 普通任务不影响高优先级任务，
+        // 它总是在之前提交的高优先级任务之后取出
+        void push(LogTask&& task, Lane lane, std::uint64_t producer);
+
+        // 取出下一个任务: 高优先级通道的第一个任务可以取出时取出它，否则取出普通通道的第一个任务。队列不能为空。
+        LogTask pop();
+
+        bool empty() const;
+        std::size_t size() const;
+        void clear();
+    };
 
     // 包含三组线程和任务列表，三组线程分别负责格式化、输出到控制台、输出到文件
   private:
     std::mutex m_format_mtx;
     std::condition_variable m_format_condition;
     std::thread m_format_thread;
-    std::queue<std::function<void(void)>> m_format_queue;
+    TaskQueue m_format_queue;
+    std::atomic<std::size_t> m_format_queue_size; // 格式化队列长度，供生产者与自旋等待无锁读取
+    bool m_format_waiting;                        // 格式化线程正在条件变量上休眠，受 m_format_mtx 保护
+    bool m_format_busy;                           // 格式化线程已取出任务、尚未回到等待，受 m_format_mtx 保护
 
     std::mutex m_console_output_mtx;
     std::condition_variable m_console_output_condition;
     std::thread m_console_output_thread;
-    std::queue<std::function<void(void)>> m_console_output_queue;
+    TaskQueue m_console_output_queue;
+    std::atomic<std::size_t> m_console_output_queue_size;
+    bool m_console_output_waiting;
+    bool m_console_output_busy;
 
     std::mutex m_file_output_mtx;
     std::condition_variable m_file_output_condition;
     std::thread m_file_output_thread;
-    std::queue<std::function<void(void)>> m_file_output_queue;
+    TaskQueue m_file_output_queue;
+    std::atomic<std::size_t> m_file_output_queue_size;
+    bool m_file_output_waiting;
+    bool m_file_output_busy;
 
-    bool m_stop;
-    bool m_format_stop;
+    // m_stop 在持有全部三把锁时置位; m_format_stop 由格式化线程在 m_format_mtx 下置位，而输出线程在各自的锁下读取
+    std::atomic<bool> m_stop;
+    std::atomic<bool> m_format_stop;  // 格式化线程已处理完所有任务，此后输出队列不会再增加
+    std::atomic<bool> m_fork_pending; // fork() 进行中，后台线程不再取出新任务
+
+    // 是否启用优先级通道(BackendOptions::priority_lanes)，构造后不再修改
+    bool m_priority_lanes;
+
+    // 协程日志接口的背压: 格式化队列长度达到 m_async_queue_limit 时挂起的协程，受 m_format_mtx 保护
+    std::size_t m_async_queue_limit;
+    std::vector<std::function<void(void)>> m_async_waiters;
+
+    // 启动后台线程时使用的参数，fork 后在子进程中重新启动时使用
+    BackendOptions m_backend;
+
+    // 后台线程的等待策略，构造后不再修改
+    WaitStrategy m_wait_strategy;
+    unsigned int m_spin_count;
+    std::chrono::milliseconds m_batch_interval;
+
+    // 运行统计，均只由对应的后台线程写入
+    Counter m_formatted;                   // 格式化完成的日志条数，由 Logger::output() 累加
+    Histogram m_format_time;               // 格式化任务的耗时
+    Counter m_format_queue_high_watermark; // 各队列长度的历史最大值，在取出任务时记录
+    Counter m_console_queue_high_watermark;
+    Counter m_file_queue_high_watermark;
 
   private:
     ThreadsPool();
@@ -42,22 +141,138 @@ class ThreadsPool {
     ThreadsPool& operator=(const ThreadsPool&) = delete;
     static ThreadsPool& getThreadsPool();
 
+    // 启动三个后台线程
+    void startThreads(const BackendOptions& backend);
+
+    // 后台线程的运行参数，在线程池构造时读取
+    struct Options {
+        std::mutex mtx;
+        BackendOptions backend;
+        bool started = false; // 线程池已构造，之后的修改不再生效
+    };
+
+    static Options& options();
+
+    // 设置后台线程的运行参数。线程池已启动时抛出 std::runtime_error.
+    static void configure(const BackendOptions& backend);
+
+    // 当前线程的生产者编号，从 1 开始，每个线程第一次调用时分配
+    static std::uint64_t producerId();
+
+    // 日志等级对应的通道: 启用优先级通道时 WARNING/ERROR 进入高优先级通道
+    Lane laneOf(LogLevel level) const;
+
+    // 提交任务。lane 与 producer 见 TaskQueue::push(); 与日志无关的任务使用 Lane::NORMAL.
     template <typename Func, typename... Args>
-    void addFormatTask(Func&& func, Args&&... args);
+    void addFormatTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args);
 
     template <typename Func, typename... Args>
-    void addConsoleOutputTask(Func&& func, Args&&... args);
+    void addConsoleOutputTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args);
 
     template <typename Func, typename... Args>
-    void addFileOutputTask(Func&& func, Args&&... args);
+    void addFileOutputTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args);
 
     template <typename Func, typename... Args>
     void addTask(bool console, bool file, Func&& func, Args&&... args);
+
+    // 格式化队列长度是否低于 async_queue_limit
+    bool hasAsyncSpace() const;
+
+    // 格式化队列已满时注册 resume, 由格式化线程在队列长度降到 async_queue_limit 以下后调用，返回 true;
+    // 队列未满或线程池正在退出时不注册，返回 false.
+    bool waitForAsyncSpace(std::function<void(void)> resume);
+
+    // 按等待策略等待，直到 ready() 为真或到达 deadline. 调用前与返回后均持有 lock.
+    // size 为对应队列的长度，自旋时只读取它而不加锁; waiting 标记线程是否在条件变量上休眠。
+    template <typename Ready>
+    void waitForTask(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+                     const std::atomic<std::size_t>& size, bool& waiting, Ready&& ready,
+                     std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    // 自旋等待时降低 CPU 占用与功耗
+    static void cpuRelax();
+
+    // 线程池析构时，格式化线程处理完所有任务之后、通知输出线程退出之前调用的函数。
+    // 由 Logger 注册，用于输出仍被折叠的重复日志的汇总信息; 此时仍可以向输出队列提交任务。
+    static std::atomic<void (*)()>& drainHook();
+
+    // 格式化线程的定时任务，由 Logger 注册，用于输出时间窗口已过的重复日志汇总与调用点的限流汇总。
+    // 格式化线程在队列为空或到达上次返回的时间时调用，返回下一次需要调用的时间; 调用时可以提交日志。
+    static std::atomic<std::chrono::steady_clock::time_point (*)()>& timerHook();
+
+    // fork 处理(pthread_atfork): fork() 前等待后台线程处理完已提交的任务(最多 kForkDrainTimeout)并停在安全点,
+    // 持有各队列的锁直到 fork() 返回; 子进程中释放这些锁、丢弃父进程未处理完的任务并重新启动后台线程。
+    static constexpr std::chrono::milliseconds kForkDrainTimeout{100};
+    static std::atomic<ThreadsPool*>& forkTarget(); // 已构造且未开始析构的线程池(fork 处理与回收旧配置)
+    // 加锁并等待后台线程执行完手头的任务，返回时持有 mtx
+    void quiesce(std::mutex& mtx, std::condition_variable& condition, const bool& busy);
+
+    // 日志路径上由生产者线程或用户调用持有的其他锁(飞行记录器的环形缓冲区、控制台参数、协程恢复函数)。
+    // fork() 前在后台线程停下之后按登记顺序加锁，fork() 返回后释放，子进程不会继承被已不存在的线程锁住的锁。
+    // 不能在后台线程停下之前加锁: 后台线程执行的任务(例如飞行记录器转储)也会获取这些锁。
+    struct ForkLocks {
+        std::mutex mtx;
+        std::vector<std::mutex*> locks;
+    };
+    static ForkLocks& forkLocks();
+    static void addForkLock(std::mutex& mtx); // 登记的锁在进程退出前不能销毁
+
+    static void prepareFork();
+    static void parentAfterFork();
+    static void childAfterFork();
 };
 
+template <typename Func, typename... Args>
+void ThreadsPool::addFormatTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args) {
+    LogTask task(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock(m_format_mtx);
+        m_format_queue.push(std::move(task), lane, producer);
+        m_format_queue_size.store(m_format_queue.size(), std::memory_order_relaxed);
+        wake = m_format_waiting;
+        // std::cout << "Add task to format thread queue.\n";
+    }
+    // 仅在格式化线程休眠时才唤醒，避免每条日志都产生一次 futex 系统调用
+    if (wake)
+        m_format_condition.notify_one();
+}
+
+template <typename Func, typename... Args>
+void ThreadsPool::addConsoleOutputTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args) {
+    LogTask task(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock(m_console_output_mtx);
+        m_console_output_queue.push(std::move(task), lane, producer);
+        m_console_output_queue_size.store(m_console_output_queue.size(), std::memory_order_relaxed);
+        wake = m_console_output_waiting;
+        // std::cout << "Add task to console output thread queue.\n";
+    }
+    if (wake)
+        m_console_output_condition.notify_one();
+}
+
+template <typename Func, typename... Args>
+void ThreadsPool::addFileOutputTask(Lane lane, std::uint64_t producer, Func&& func, Args&&... args) {
+    LogTask task(std::bind(std::forward<Func>(func), std::forward<Args>(args)...));
+    bool wake;
+    {
+        std::unique_lock<std::mutex> lock(m_file_output_mtx);
+        m_file_output_queue.push(std::move(task), lane, producer);
+        m_file_output_queue_size.store(m_file_output_queue.size(), std::memory_order_relaxed);
+        wake = m_file_output_waiting;
+        // std::cout << "Add task to file output thread queue.\n";
+    }
+    if (wake)
+        m_file_output_condition.notify_one();
+}
+
+#ifdef MYLOGGER_HEADER_ONLY
 #ifndef MYLOGGER_THREADSPOOL_INL_HPP
 #include "threadspool-inl.hpp"
 MYLOGGER_THREADSPOOL_INL_HPP
 #endif // MYLOGGER_THREADSPOOL_INL_HPP
+#endif // MYLOGGER_HEADER_ONLY
 
 #endif // MYLOGGER_THREADSPOOL_HPP
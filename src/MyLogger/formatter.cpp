@@ -0,0 +1,12 @@
+// 编译库模式下格式化相关的非模板实现: 参数格式化、格式化字符串解析、输出布局、Formatter 对象池、调用点与诊断上下文
+
+#ifndef MYLOGGER_COMPILED_LIB
+#error "MYLOGGER_COMPILED_LIB must be defined when building the MyLogger library."
+#endif
+
+#include "MyLogger/argformatter-inl.hpp"
+#include "MyLogger/callsite-inl.hpp"
+#include "MyLogger/formatter-inl.hpp"
+#include "MyLogger/formatterpool-inl.hpp"
+#include "MyLogger/layout-inl.hpp"
+#include "MyLogger/logcontext-inl.hpp"
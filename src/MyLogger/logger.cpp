@@ -0,0 +1,9 @@
+// 编译库模式下 Logger 的非模板实现，以及运行时控制通道与飞行记录器
+
+#ifndef MYLOGGER_COMPILED_LIB
+#error "MYLOGGER_COMPILED_LIB must be defined when building the MyLogger library."
+#endif
+
+#include "MyLogger/controller-inl.hpp"
+#include "MyLogger/flightrecorder-inl.hpp"
+#include "MyLogger/logger-inl.hpp"
@@ -0,0 +1,11 @@
+// 编译库模式下输出相关的非模板实现: 控制台与文件输出、二进制数据的编码、文件索引、多进程共享缓冲区、运行统计
+
+#ifndef MYLOGGER_COMPILED_LIB
+#error "MYLOGGER_COMPILED_LIB must be defined when building the MyLogger library."
+#endif
+
+#include "MyLogger/blob-inl.hpp"
+#include "MyLogger/fileindex-inl.hpp"
+#include "MyLogger/logwriter-inl.hpp"
+#include "MyLogger/sharedsink-inl.hpp"
+#include "MyLogger/stats-inl.hpp"
@@ -0,0 +1,9 @@
+// 编译库模式下线程池、任务内存区与后台线程选项的非模板实现
+
+#ifndef MYLOGGER_COMPILED_LIB
+#error "MYLOGGER_COMPILED_LIB must be defined when building the MyLogger library."
+#endif
+
+#include "MyLogger/arena-inl.hpp"
+#include "MyLogger/threadoptions-inl.hpp"
+#include "MyLogger/threadspool-inl.hpp"
@@ -0,0 +1,539 @@
+// MyLogger 并发正确性压力测试。多个生产者线程以由种子决定的负载(日志函数、等级、参数类型、源码位置、上下文、
+// 二进制数据的组合)写入日志，结束后逐行检查输出: 每个生产者的日志都恰好出现一次(不丢失、不重复)，且按提交顺序排列。
+// 每个场景覆盖一种输出目标、后台线程等待策略、内存区或退出方式的组合，在独立的子进程中运行(日志库为进程内单例)。
+// 另有针对单项功能的场景: 重复日志折叠与优先级通道同时启用时、以及带着被折叠的日志退出时汇总信息的位置,
+// 以及通过控制通道的套接字修改日志等级与读取运行统计。
+// 线程调度本身无法重现，相同的种子只保证每个生产者提交的日志序列相同; 出错时以相同的参数与 --scenario 重新运行。
+// 用法: stress [--producers N] [--messages N] [--seed N] [--scenario 场景名] [--list]
+//     --producers  生产者线程数，默认 8
+//     --messages   每个生产者的日志条数，默认 20000
+//     --seed       负载的随机种子，默认 1
+//     --scenario   只运行一个场景，且直接在当前进程中运行(便于调试器与 ThreadSanitizer 定位)
+//     --list       列出所有场景
+// 所有场景都通过时返回 0. 使用 -DMYLOGGER_TSAN=ON 构建可在 ThreadSanitizer 下运行。
+
+#include "MyLogger/logger.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// ThreadSanitizer 不支持多线程进程 fork 之后再创建线程，此时跳过多进程共享日志的场景
+#if defined(__SANITIZE_THREAD__)
+#define STRESS_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define STRESS_TSAN 1
+#endif
+#endif
+
+using log = Logger;
+
+namespace {
+
+const char* const kMarker = "#stress p=";
+
+enum class Sink { FILE, CONSOLE, BOTH };
+
+// 场景的负载与检查方式
+enum class Mode {
+    PRODUCERS, // 多个生产者线程，检查每个生产者的日志不丢失、不重复且按顺序排列
+    SHARED,    // 同 PRODUCERS, 但生产者分布在两个工作进程中，由收集进程写入文件
+    DEDUP,     // 重复日志之后紧跟一条 ERROR, 检查汇总信息位于被折叠的日志与 ERROR 之间; 最后以重复日志结束,
+               // 检查 flush() 或退出时输出其汇总信息
+    CONTROL,   // 启动控制通道失败后重新启动，通过套接字修改日志等级并读取运行统计，检查回复与等级是否生效
+};
+
+struct Scenario {
+    const char* name;
+    Sink sink;
+    WaitStrategy wait_strategy;
+    std::size_t arena_budget; // 0 表示不启用内存区
+    bool shutdown;            // 不调用 flush(), 带着积压的日志直接退出，由析构过程输出剩余的日志
+    Mode mode;
+};
+
+const Scenario kScenarios[] = {
+    {"blocking-file", Sink::FILE, WaitStrategy::BLOCKING, 0, false, Mode::PRODUCERS},
+    {"blocking-console", Sink::CONSOLE, WaitStrategy::BLOCKING, 0, false, Mode::PRODUCERS},
+    {"blocking-both", Sink::BOTH, WaitStrategy::BLOCKING, 0, false, Mode::PRODUCERS},
+    {"spin-both", Sink::BOTH, WaitStrategy::SPIN_THEN_PARK, 0, false, Mode::PRODUCERS},
+    {"busy-both", Sink::BOTH, WaitStrategy::BUSY_POLL, 0, false, Mode::PRODUCERS},
+    {"timed-both", Sink::BOTH, WaitStrategy::TIMED, 0, false, Mode::PRODUCERS},
+    {"arena-both", Sink::BOTH, WaitStrategy::BLOCKING, 16 * 1024 * 1024, false, Mode::PRODUCERS},
+    {"arena-exhausted", Sink::BOTH, WaitStrategy::BLOCKING, 256 * 1024, false, Mode::PRODUCERS},
+    {"shutdown-file", Sink::FILE, WaitStrategy::BLOCKING, 0, true, Mode::PRODUCERS},
+    {"shutdown-both", Sink::BOTH, WaitStrategy::SPIN_THEN_PARK, 16 * 1024 * 1024, true, Mode::PRODUCERS},
+    {"shared-file", Sink::FILE, WaitStrategy::BLOCKING, 0, false, Mode::SHARED},
+    {"dedup-order", Sink::BOTH, WaitStrategy::BLOCKING, 0, false, Mode::DEDUP},
+    {"dedup-shutdown", Sink::BOTH, WaitStrategy::BLOCKING, 0, true, Mode::DEDUP},
+    {"control-socket", Sink::FILE, WaitStrategy::BLOCKING, 0, false, Mode::CONTROL},
+};
+
+// DEDUP 场景: 每一轮先写 kDedupRepeats 条相同的 INFO, 再写一条 ERROR; 最后再写 kDedupRepeats 条相同的 INFO
+const unsigned long kDedupRepeats = 5;
+
+// SplitMix64: 由种子决定的伪随机数序列，与标准库实现无关
+class Random {
+  private:
+    std::uint64_t m_state;
+
+  public:
+    explicit Random(std::uint64_t seed) : m_state(seed) {}
+
+    std::uint64_t operator()() {
+        std::uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+struct Options {
+    unsigned int producers = 8;
+    unsigned long messages = 20000;
+    unsigned long seed = 1;
+    std::string scenario;
+};
+
+const Scenario* findScenario(const std::string& name) {
+    for (const Scenario& scenario : kScenarios) {
+        if (name == scenario.name)
+            return &scenario;
+    }
+    return nullptr;
+}
+
+std::string logFile(const Scenario& scenario) {
+    return std::string("stress-") + scenario.name + ".log";
+}
+
+std::string consoleFile(const Scenario& scenario) {
+    return std::string("stress-") + scenario.name + ".out";
+}
+
+std::string controlSocket(const Scenario& scenario) {
+    return std::string("stress-") + scenario.name + ".sock";
+}
+
+// 一个生产者的日志: 标记行 "#stress p=<生产者> s=<序号>" 之后为随机选择的参数，hexdump 的数据行不以标记开头
+void produce(const Scenario& scenario, const Options& options, unsigned int id) {
+    Random rng(options.seed * 1000003 + id);
+    std::string text = "producer-" + std::to_string(id);
+    unsigned char payload[64];
+
+    for (unsigned long seq = 0; seq < options.messages; seq++) {
+        std::uint64_t r = rng();
+        switch (r % 10) {
+        case 0:
+            log::debug("#stress p={} s={} {:#x}\n", id, seq, r >> 8);
+            break;
+        case 1:
+            log::info("#stress p={} s={} {} {}\n", id, seq, text, static_cast<double>(r % 10000) / 7);
+            break;
+        case 2:
+            log::warning("#stress p={} s={} {:>12} {}\n", id, seq, "padded", static_cast<int>(r % 1000) - 500);
+            break;
+        case 3:
+            log::error("#stress p={0} s={1} {3} {2}\n", id, seq, 'c', true);
+            break;
+        case 4:
+            log::log(static_cast<LogLevel>(r % 4), "#stress p={} s={} {level}\n", id, seq);
+            break;
+        case 5:
+            log::info(MYLOGGER_HERE, "#stress p={} s={} {func}:{line}\n", id, seq);
+            break;
+        case 6: {
+            MYLOGGER_CONTEXT("producer", id);
+            log::info("#stress p={} s={} {ctx}\n", id, seq);
+            break;
+        }
+        case 7: {
+            std::size_t size = static_cast<std::size_t>(r % sizeof(payload)) + 1;
+            for (std::size_t i = 0; i < size; i++)
+                payload[i] = static_cast<unsigned char>(rng());
+            log::hexdump(LogLevel::INFO, payload, size, "#stress p={} s={} {} bytes\n", id, seq, size);
+            break;
+        }
+        case 8:
+            // 仅输出到当前场景的输出目标的日志函数
+            if (scenario.sink == Sink::FILE)
+                log::infof("#stress p={} s={} file only\n", id, seq);
+            else if (scenario.sink == Sink::CONSOLE)
+                log::infoc("#stress p={} s={} console only\n", id, seq);
+            else
+                log::info("#stress p={} s={} {thread}\n", id, seq);
+            break;
+        default:
+            log::info("#stress p={} s={}\n", id, seq);
+            if (r & 0x100)
+                std::this_thread::yield();
+            break;
+        }
+    }
+}
+
+void runProducers(const Scenario& scenario, const Options& options, unsigned int first, unsigned int step) {
+    std::vector<std::thread> producers;
+    for (unsigned int id = first; id < options.producers; id += step) {
+        producers.emplace_back([&scenario, &options, id] { produce(scenario, options, id); });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+// 当前进程打开的文件描述符数
+std::size_t countFds() {
+    std::size_t count = 0;
+    if (DIR* dir = opendir("/proc/self/fd")) {
+        while (readdir(dir))
+            count++;
+        closedir(dir);
+    }
+    return count;
+}
+
+// 向控制通道发送 commands, 读取回复直到收到 replies 行 "OK" 或 "ERROR ..."，返回全部回复; 连接失败时返回空串
+std::string sendControl(const std::string& socket_path, const std::string& commands, unsigned int replies) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        write(fd, commands.data(), commands.size()) != static_cast<ssize_t>(commands.size())) {
+        if (fd >= 0)
+            close(fd);
+        return "";
+    }
+
+    std::string reply;
+    char buffer[4096];
+    std::size_t line_start = 0;
+    while (replies > 0) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+        reply.append(buffer, static_cast<std::size_t>(length));
+        std::size_t end;
+        while (replies > 0 && (end = reply.find('\n', line_start)) != std::string::npos) {
+            if (reply.compare(line_start, 2, "OK") == 0 || reply.compare(line_start, 5, "ERROR") == 0)
+                replies--;
+            line_start = end + 1;
+        }
+    }
+    close(fd);
+    return reply;
+}
+
+// CONTROL 场景，返回进程的退出码
+int runControl(const Scenario& scenario) {
+    std::string socket_path = controlSocket(scenario);
+
+    // 监视不存在的目录会失败，此时不能遗留文件描述符与套接字文件，且之后可以重新启动
+    std::size_t fds = countFds();
+    try {
+        log::startControl(socket_path, "stress-missing-directory/control.conf");
+        std::cerr << "startControl() with a missing directory did not fail\n";
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+    if (countFds() != fds || access(socket_path.c_str(), F_OK) == 0) {
+        std::cerr << "Failed startControl() leaked file descriptors or the socket file\n";
+        return 1;
+    }
+    log::startControl(socket_path);
+
+    log::info("#control before\n");
+    std::string reply = sendControl(socket_path, "level WARNING\nstats\nsampling many\ndedup -5\n", 4);
+    std::string::size_type stats = reply.find("mylogger_enqueued_total ");
+    std::string expected_errors =
+        "ERROR expected a queue threshold: many\nERROR expected a window in milliseconds: -5\n";
+    if (reply.compare(0, 3, "OK\n") != 0 || stats == std::string::npos ||
+        reply.find("\nOK\n" + expected_errors, stats) == std::string::npos) {
+        std::cerr << "Unexpected reply from control socket:\n" << reply << "\n";
+        return 1;
+    }
+
+    // 等级已修改为 WARNING
+    log::info("#control hidden\n");
+    log::warning("#control shown\n");
+    log::flush();
+    return 0;
+}
+
+// 在当前进程中运行场景，返回进程的退出码
+int runScenario(const Scenario& scenario, const Options& options) {
+    std::remove(logFile(scenario).c_str());
+    if (scenario.sink != Sink::FILE) {
+        int fd = open(consoleFile(scenario).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Failed to open " << consoleFile(scenario) << "\n";
+            return 1;
+        }
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+
+    BackendOptions backend;
+    backend.wait_strategy = scenario.wait_strategy;
+    backend.arena.budget = scenario.arena_budget;
+    log::setBackendOptions(backend);
+    log::setLevel(LogLevel::DEBUG);
+    log::setDedupWindow(std::chrono::milliseconds(0));
+    log::setSampling(0);
+    log::enableConsole(scenario.sink != Sink::FILE);
+    log::enabledFile(scenario.sink != Sink::CONSOLE);
+    log::setFile(logFile(scenario));
+
+    if (scenario.mode == Mode::DEDUP) {
+        // 汇总信息在 ERROR 到达格式化线程时才产生，ERROR 进入优先通道，汇总信息不能因此排到 ERROR 之后
+        log::setDedupWindow(std::chrono::seconds(10));
+        for (unsigned long round = 0; round < options.messages / 100 + 1; round++) {
+            for (unsigned long i = 0; i < kDedupRepeats; i++)
+                log::info("#dedup same {}\n", round);
+            log::error("#dedup boom {}\n", round);
+        }
+        for (unsigned long i = 0; i < kDedupRepeats; i++)
+            log::info("#dedup tail\n");
+        if (!scenario.shutdown)
+            log::flush();
+        return 0;
+    }
+
+    if (scenario.mode == Mode::CONTROL)
+        return runControl(scenario);
+
+    if (scenario.mode == Mode::PRODUCERS) {
+        runProducers(scenario, options, 0, 1);
+        if (!scenario.shutdown)
+            log::flush();
+        return 0;
+    }
+
+    // 收集进程 fork 出两个工作进程，生产者按编号的奇偶分配
+    std::string shm_name = "/mylogger-stress-" + std::to_string(getpid());
+    log::startSharedCollector(shm_name, 64 * 1024 * 1024);
+    pid_t workers[2];
+    for (unsigned int w = 0; w < 2; w++) {
+        workers[w] = fork();
+        if (workers[w] == 0) {
+            runProducers(scenario, options, w, 2);
+            log::flush();
+            std::exit(0);
+        }
+    }
+    int result = 0;
+    for (pid_t worker : workers) {
+        int status = 0;
+        if (worker < 0 || waitpid(worker, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            result = 1;
+    }
+    if (log::stats().shared_dropped != 0) {
+        std::cerr << "Shared buffer dropped " << log::stats().shared_dropped << " messages\n";
+        result = 1;
+    }
+    return result;
+}
+
+// 检查输出文件中每个生产者的日志恰好出现一次且按顺序排列，返回错误描述，为空表示通过
+std::string verify(const std::string& file_name, const Options& options) {
+    std::ifstream in(file_name);
+    if (!in.is_open())
+        return "cannot open " + file_name;
+
+    std::vector<unsigned long> next(options.producers, 0);
+    std::string line;
+    std::size_t line_no = 0;
+    std::size_t marker_len = std::strlen(kMarker);
+    while (std::getline(in, line)) {
+        line_no++;
+        if (line.compare(0, marker_len, kMarker) != 0)
+            continue;
+
+        unsigned int id = 0;
+        unsigned long seq = 0;
+        if (std::sscanf(line.c_str() + marker_len, "%u s=%lu", &id, &seq) != 2 || id >= options.producers)
+            return file_name + ":" + std::to_string(line_no) + ": malformed line: " + line;
+        if (seq != next[id]) {
+            return file_name + ":" + std::to_string(line_no) + ": producer " + std::to_string(id) + " expected s=" +
+                   std::to_string(next[id]) + ", got s=" + std::to_string(seq) +
+                   (seq < next[id] ? " (duplicate or reordered)" : " (lost)");
+        }
+        next[id]++;
+    }
+
+    for (unsigned int id = 0; id < options.producers; id++) {
+        if (next[id] != options.messages) {
+            return file_name + ": producer " + std::to_string(id) + " wrote " + std::to_string(next[id]) + " of " +
+                   std::to_string(options.messages) + " messages";
+        }
+    }
+    return "";
+}
+
+// 检查 DEDUP 场景的输出: 每一轮依次为第一条 INFO、汇总信息与 ERROR
+std::string verifyDedup(const std::string& file_name, const Options& options) {
+    std::ifstream in(file_name);
+    if (!in.is_open())
+        return "cannot open " + file_name;
+
+    std::vector<std::string> expected;
+    for (unsigned long round = 0; round < options.messages / 100 + 1; round++) {
+        expected.push_back("#dedup same " + std::to_string(round));
+        expected.push_back("Last message repeated " + std::to_string(kDedupRepeats - 1) + " times.");
+        expected.push_back("#dedup boom " + std::to_string(round));
+    }
+    expected.push_back("#dedup tail");
+    expected.push_back("Last message repeated " + std::to_string(kDedupRepeats - 1) + " times.");
+
+    std::string line;
+    std::size_t line_no = 0;
+    while (std::getline(in, line)) {
+        if (line_no >= expected.size())
+            return file_name + ":" + std::to_string(line_no + 1) + ": unexpected line: " + line;
+        if (line != expected[line_no]) {
+            return file_name + ":" + std::to_string(line_no + 1) + ": expected \"" + expected[line_no] + "\", got \"" +
+                   line + "\"";
+        }
+        line_no++;
+    }
+    if (line_no != expected.size())
+        return file_name + ": wrote " + std::to_string(line_no) + " of " + std::to_string(expected.size()) + " lines";
+    return "";
+}
+
+// 检查 CONTROL 场景的输出: 修改等级之后的 INFO 不再输出
+std::string verifyControl(const std::string& file_name, const Options&) {
+    std::ifstream in(file_name);
+    if (!in.is_open())
+        return "cannot open " + file_name;
+
+    const char* const expected[] = {"#control before", "#control shown"};
+    std::string line;
+    std::size_t line_no = 0;
+    while (std::getline(in, line)) {
+        if (line_no >= 2 || line != expected[line_no])
+            return file_name + ":" + std::to_string(line_no + 1) + ": unexpected line: " + line;
+        line_no++;
+    }
+    if (line_no != 2)
+        return file_name + ": wrote " + std::to_string(line_no) + " of 2 lines";
+    return "";
+}
+
+// 在子进程中运行场景并检查输出，返回是否通过
+bool runAndVerify(const Scenario& scenario, const Options& options, const char* self) {
+#ifdef STRESS_TSAN
+    if (scenario.mode == Mode::SHARED) {
+        std::cout << "[SKIP] " << scenario.name << " (not supported under ThreadSanitizer)" << std::endl;
+        return true;
+    }
+#endif
+    auto start = std::chrono::steady_clock::now();
+    std::cout.flush();
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::string producers = std::to_string(options.producers);
+        std::string messages = std::to_string(options.messages);
+        std::string seed = std::to_string(options.seed);
+        execl(self, self, "--producers", producers.c_str(), "--messages", messages.c_str(), "--seed", seed.c_str(),
+              "--scenario", scenario.name, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    int status = 0;
+    std::string error;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0) {
+        error = "failed to start";
+    } else if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        error = WIFSIGNALED(status) ? "killed by signal " + std::to_string(WTERMSIG(status))
+                                    : "exited with " + std::to_string(WEXITSTATUS(status));
+    } else {
+        auto check = scenario.mode == Mode::DEDUP     ? verifyDedup
+                     : scenario.mode == Mode::CONTROL ? verifyControl
+                                                      : verify;
+        if (scenario.sink != Sink::CONSOLE)
+            error = check(logFile(scenario), options);
+        if (error.empty() && scenario.sink != Sink::FILE)
+            error = check(consoleFile(scenario), options);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (error.empty() ? "[ OK ] " : "[FAIL] ") << scenario.name << " (" << seconds << " s)";
+    if (!error.empty())
+        std::cout << ": " << error;
+    std::cout << std::endl;
+
+    if (error.empty()) {
+        std::remove(logFile(scenario).c_str());
+        std::remove(FileIndex::indexFile(logFile(scenario)).c_str());
+        std::remove(consoleFile(scenario).c_str());
+    }
+    return error.empty();
+}
+
+int usage() {
+    std::cerr << "Usage: stress [--producers N] [--messages N] [--seed N] [--scenario NAME] [--list]\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            for (const Scenario& scenario : kScenarios)
+                std::cout << scenario.name << "\n";
+            return 0;
+        }
+        if (i + 1 >= argc)
+            return usage();
+        if (arg == "--producers") {
+            options.producers = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--messages") {
+            options.messages = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seed") {
+            options.seed = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--scenario") {
+            options.scenario = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (options.producers == 0 || options.messages == 0)
+        return usage();
+
+    if (!options.scenario.empty()) {
+        const Scenario* scenario = findScenario(options.scenario);
+        if (scenario == nullptr) {
+            std::cerr << "Unknown scenario: " << options.scenario << "\n";
+            return 2;
+        }
+        return runScenario(*scenario, options);
+    }
+
+    std::cout << "producers=" << options.producers << " messages=" << options.messages << " seed=" << options.seed
+              << std::endl;
+    bool passed = true;
+    for (const Scenario& scenario : kScenarios) {
+        passed = runAndVerify(scenario, options, "/proc/self/exe") && passed;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+// 日志文件查询工具: 通过 Logger::setFileIndex() 生成的索引文件，只读取可能包含匹配日志的块并输出到标准输出。
+// 块内的日志不再逐条过滤，可以再通过 grep 等工具筛选。
+// 用法: logquery [--from "YYYY-MM-DD HH:MM:SS"] [--to "YYYY-MM-DD HH:MM:SS"] [--level 最低等级] [--ranges] <日志文件>
+//     --from/--to  时间范围(本地时间，与 {time} 的默认格式相同)，默认不限
+//     --level      只查询该等级及以上的日志: DEBUG|INFO|WARNING|ERROR, 默认 DEBUG
+//     --ranges     只输出匹配区域的偏移与长度
+
+#include "MyLogger/fileindex.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: logquery [--from \"YYYY-MM-DD HH:MM:SS\"] [--to \"YYYY-MM-DD HH:MM:SS\"] "
+                 "[--level DEBUG|INFO|WARNING|ERROR] [--ranges] <log_file>\n";
+    return 2;
+}
+
+// 解析本地时间，失败时返回 false
+bool parseTime(const std::string& text, std::chrono::system_clock::time_point& time) {
+    std::tm tm;
+    std::memset(&tm, 0, sizeof(tm));
+    const char* end = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &tm);
+    if (end == nullptr || *end != '\0')
+        return false;
+    tm.tm_isdst = -1;
+    std::time_t t = std::mktime(&tm);
+    if (t == static_cast<std::time_t>(-1))
+        return false;
+    time = std::chrono::system_clock::from_time_t(t);
+    return true;
+}
+
+// 将等级名转换为该等级及以上的等级位图，失败时返回 0
+std::uint32_t parseLevel(const std::string& text) {
+    const char* const kNames[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+    for (unsigned int i = 0; i < 4; i++) {
+        if (text == kNames[i])
+            return 0xfu & ~((1u << i) - 1);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto from = std::chrono::system_clock::time_point::min();
+    auto to = std::chrono::system_clock::time_point::max();
+    std::uint32_t levels = 0xf;
+    bool ranges_only = false;
+    std::string log_file;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--from" && has_value) {
+            if (!parseTime(argv[++i], from))
+                return usage();
+        } else if (arg == "--to" && has_value) {
+            // 时间戳精确到秒，包含这一秒内的日志
+            if (!parseTime(argv[++i], to))
+                return usage();
+            to += std::chrono::seconds(1) - std::chrono::system_clock::duration(1);
+        } else if (arg == "--level" && has_value) {
+            levels = parseLevel(argv[++i]);
+            if (levels == 0)
+                return usage();
+        } else if (arg == "--ranges") {
+            ranges_only = true;
+        } else if (log_file.empty() && arg.compare(0, 2, "--") != 0) {
+            log_file = arg;
+        } else {
+            return usage();
+        }
+    }
+    if (log_file.empty())
+        return usage();
+
+    try {
+        std::vector<FileIndex::Range> ranges = FileIndex::query(log_file, from, to, levels);
+        if (ranges_only) {
+            for (const FileIndex::Range& range : ranges)
+                std::cout << range.offset << ' ' << range.size << '\n';
+            return 0;
+        }
+
+        std::ifstream in(log_file, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open log file: " << log_file << ".\n";
+            return 1;
+        }
+        std::vector<char> buffer(1 << 20);
+        for (const FileIndex::Range& range : ranges) {
+            in.seekg(static_cast<std::streamoff>(range.offset));
+            std::uint64_t remaining = range.size;
+            while (remaining > 0 && in) {
+                std::size_t chunk = remaining < buffer.size() ? static_cast<std::size_t>(remaining) : buffer.size();
+                in.read(buffer.data(), static_cast<std::streamsize>(chunk));
+                std::cout.write(buffer.data(), in.gcount());
+                remaining -= static_cast<std::uint64_t>(in.gcount());
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}